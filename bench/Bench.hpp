@@ -0,0 +1,47 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include <Moe.LuaWrapper/State.hpp>
+
+#include <chrono>
+#include <cstdio>
+
+namespace bench
+{
+    /**
+     * @brief 执行一段脚本并返回耗时
+     * @param L 状态机
+     * @param script 脚本
+     * @return 耗时（毫秒），不包括编译时间
+     */
+    inline double RunScript(moe::LuaWrapper::State& L, const char* script)
+    {
+        L.LoadString(script);
+
+        auto start = std::chrono::steady_clock::now();
+        L.CallAndThrow(0, 0);
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    }
+
+    /**
+     * @brief 输出一项结果
+     */
+    inline void Report(const char* name, double ms)
+    {
+        ::printf("%-48s %10.2f ms\n", name, ms);
+    }
+
+    /**
+     * @brief 大量创建小型用户类型对象，对比有无__gc时的分配与回收开销
+     */
+    void RunGcBench();
+
+    /**
+     * @brief 从Lua调用绑定的lambda，对比直接保存函数对象与经由std::function的开销
+     */
+    void RunFunctorBench();
+}
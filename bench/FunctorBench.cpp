@@ -0,0 +1,40 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#include "Bench.hpp"
+
+#include <functional>
+
+using namespace moe::LuaWrapper;
+
+namespace
+{
+    std::string MakeCallScript(const char* func)
+    {
+        std::string ret = "local f = require('functorbench').";
+        ret.append(func);
+        ret.append("\n"
+            "local s = 0\n"
+            "for i = 1, 5000000 do\n"
+            "  s = f(i, 1)\n"
+            "end\n");
+        return ret;
+    }
+}
+
+void bench::RunFunctorBench()
+{
+    int offset = 0;
+    auto add = [offset](int a, int b) { return a + b + offset; };
+
+    State L;
+    L.OpenStdLibs();
+    L.RegisterModule("functorbench")
+        .RegisterMethod("Functor", add)
+        .RegisterMethod("StdFunction", std::function<int(int, int)>(add));
+
+    Report("call: 5M calls to a lambda", RunScript(L, MakeCallScript("Functor").c_str()));
+    Report("call: 5M calls to a std::function", RunScript(L, MakeCallScript("StdFunction").c_str()));
+}
@@ -0,0 +1,89 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#include "Bench.hpp"
+
+using namespace moe::LuaWrapper;
+
+namespace
+{
+    /**
+     * @brief 可平凡析构的类型，不注册__gc
+     */
+    struct PlainPoint
+    {
+        static void Register(TypeRegister<PlainPoint>& reg)
+        {
+            reg.RegisterMethod("GetX", &PlainPoint::GetX);
+        }
+
+        float GetX()const noexcept { return X; }
+
+        float X;
+        float Y;
+    };
+
+    /**
+     * @brief 布局相同但强制注册__gc的类型，相当于优化前的行为
+     */
+    struct FinalizedPoint
+    {
+        static void Register(TypeRegister<FinalizedPoint>& reg)
+        {
+            reg.RegisterMethod("GetX", &FinalizedPoint::GetX);
+        }
+
+        float GetX()const noexcept { return X; }
+
+        float X;
+        float Y;
+    };
+
+    PlainPoint NewPlainPoint(float x, float y)
+    {
+        return PlainPoint { x, y };
+    }
+
+    FinalizedPoint NewFinalizedPoint(float x, float y)
+    {
+        return FinalizedPoint { x, y };
+    }
+
+    std::string MakeGcScript(const char* constructor)
+    {
+        std::string ret = "local new = require('gcbench').";
+        ret.append(constructor);
+        ret.append("\n"
+            "collectgarbage('collect')\n"
+            "for i = 1, 2000000 do\n"
+            "  new(i, i)\n"
+            "end\n"
+            "collectgarbage('collect')\n");
+        return ret;
+    }
+}
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    template <>
+    struct NeedsFinalizer<FinalizedPoint> :
+        public std::true_type
+    {};
+}
+}
+
+void bench::RunGcBench()
+{
+    State L;
+    L.OpenStdLibs();
+    L.RegisterModule("gcbench")
+        .RegisterMethod("NewPlainPoint", NewPlainPoint)
+        .RegisterMethod("NewFinalizedPoint", NewFinalizedPoint);
+
+    Report("gc: 2M objects without __gc", RunScript(L, MakeGcScript("NewPlainPoint").c_str()));
+    Report("gc: 2M objects with __gc", RunScript(L, MakeGcScript("NewFinalizedPoint").c_str()));
+}
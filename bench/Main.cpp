@@ -0,0 +1,23 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#include "Bench.hpp"
+
+#include <exception>
+
+int main()
+{
+    try
+    {
+        bench::RunGcBench();
+        bench::RunFunctorBench();
+    }
+    catch (const std::exception& ex)
+    {
+        ::fprintf(stderr, "%s\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
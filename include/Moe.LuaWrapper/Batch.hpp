@@ -0,0 +1,104 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include "Details.hpp"
+#include "Reference.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    namespace details
+    {
+        template <typename TOut>
+        struct BatchOutput;
+
+        template <typename T>
+        struct BatchOutput<T*>
+        {
+            static const int kCount = 1;
+
+            static bool Store(Stack& st, T* out, size_t i)
+            {
+                if (!ArgTypeMatcher<T>::Match(st, -1))
+                    return false;
+                out[i] = st.Read<T>(-1);
+                return true;
+            }
+        };
+
+        template <>
+        struct BatchOutput<std::nullptr_t>
+        {
+            static const int kCount = 0;
+
+            static bool Store(Stack&, std::nullptr_t, size_t)
+            {
+                return true;
+            }
+        };
+    }
+
+    template <typename TOut, typename... TArgs>
+    size_t Stack::CallBatch(size_t count, TOut out, std::vector<BatchError>& errors, const TArgs*... columns)
+    {
+        using Output = details::BatchOutput<TOut>;
+
+#ifndef NDEBUG
+        unsigned topCheck = GetTop();
+#endif
+
+        if (!lua_checkstack(L, static_cast<int>(sizeof...(TArgs)) + 3))
+            MOE_LUAWRP_THROW(std::runtime_error("stack overflow"));
+
+        lua_pushcfunction(L, details::TracebackImpl);  // ... func, c
+        lua_insert(L, -2);  // ... c, func
+
+        int func = lua_gettop(L);
+        int handler = func - 1;
+
+        size_t succeeded = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            lua_pushvalue(L, func);  // ... c, func, func
+            int expand[] = { 0, (Push(columns[i]), 0)... };  // ... c, func, func, arg1, arg2
+            static_cast<void>(expand);
+
+            int ret = lua_pcall(L, static_cast<int>(sizeof...(TArgs)), Output::kCount, handler);  // ... c, func, ret1
+            if (0 != ret)
+            {
+                auto msg = lua_tostring(L, -1);
+                errors.emplace_back(i, msg ? msg : "(error object is not a string)", ret);
+            }
+            else if (!Output::Store(*this, out, i))
+            {
+                errors.emplace_back(i, "unexpected return type", LUA_ERRRUN);
+            }
+            else
+            {
+                ++succeeded;
+            }
+
+            lua_settop(L, func);  // ... c, func
+        }
+
+        lua_pop(L, 2);  // ...
+
+#ifndef NDEBUG
+        assert(topCheck - 1 == GetTop());
+#endif
+        return succeeded;
+    }
+
+    template <typename TOut, typename... TArgs>
+    size_t Stack::CallBatch(const Reference& func, size_t count, TOut out, std::vector<BatchError>& errors,
+        const TArgs*... columns)
+    {
+        Push(func);
+        return CallBatch(count, out, errors, columns...);
+    }
+}
+}
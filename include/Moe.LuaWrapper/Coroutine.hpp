@@ -0,0 +1,169 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include "Stack.hpp"
+#include "Reference.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    /**
+     * @brief 协程恢复结果
+     */
+    enum class CoroutineStatus
+    {
+        Finished,  ///< 协程已执行完毕
+        Yielded,  ///< 协程主动让出
+        Preempted,  ///< 协程因时间片耗尽被抢占
+    };
+
+    /**
+     * @brief 可分时执行的协程
+     *
+     * 协程在独立的Lua线程上执行，Resume时可以指定时间片，超出时间片后协程在下一个可让出的位置被强制让出，
+     * 宿主可以在稍后从中断处继续执行。
+     */
+    class Coroutine
+    {
+    public:
+        /**
+         * @brief 从栈顶的函数创建协程
+         * @param st 堆栈
+         * @return 协程对象
+         *
+         * [-1, +0]
+         */
+        static Coroutine Create(Stack& st)
+        {
+#ifndef NDEBUG
+            unsigned topCheck = st.GetTop();
+#endif
+
+            Coroutine ret;
+            ret.m_stThread = Stack(lua_newthread(st));  // f co
+            ret.m_stRef = Reference::Capture(st);  // f
+            lua_xmove(st, ret.m_stThread, 1);  // co: f
+
+#ifndef NDEBUG
+            assert(topCheck == st.GetTop() + 1);
+#endif
+            return ret;
+        }
+
+    public:
+        Coroutine()noexcept = default;
+
+        Coroutine(const Coroutine&) = delete;
+        Coroutine(Coroutine&&)noexcept = default;
+
+        Coroutine& operator=(const Coroutine&) = delete;
+        Coroutine& operator=(Coroutine&&)noexcept = default;
+
+    public:
+        operator bool()const noexcept
+        {
+            return !m_stRef.IsEmpty();
+        }
+
+        /**
+         * @brief 获取协程的栈
+         *
+         * 用于在Resume前推入参数，以及读取让出或返回的值。
+         */
+        Stack& GetStack()noexcept { return m_stThread; }
+
+        /**
+         * @brief 恢复协程执行
+         * @param nargs 参数个数，参数应事先推入协程栈中
+         * @param slice 时间片，不设限时协程只在主动让出或结束时返回
+         * @return 恢复结果
+         *
+         * 被抢占的协程恢复时不应传入参数。执行出错时抛出异常（无异常模式下返回错误），协程随即结束。
+         * 让出的值与返回值位于协程栈顶，个数由GetResultCount获取，再次恢复前应由调用方弹出这些值。
+         * 被抢占时个数为0，协程栈上保留的是被中断的函数的状态，不能弹出其中的任何值。
+         * 若时间片在协程内部恢复的其他协程中耗尽，该协程无法代为让出，会以错误结束，使执行回到本协程。
+         */
+        Result<CoroutineStatus> Resume(unsigned nargs, const ExecutionBudget& slice=ExecutionBudget())
+        {
+            lua_State* co = m_stThread;
+            assert(co);
+
+            if (m_bDead)
+                return details::MakeError<CoroutineStatus>("cannot resume dead coroutine");
+
+            int ret = 0;
+            int nres = 0;
+            bool preempted = false;
+            if (slice.IsUnlimited())
+                ret = ResumeImpl(co, nargs, nres);
+            else
+            {
+                details::BudgetHookScope scope(co, slice, co);
+                ret = ResumeImpl(co, nargs, nres);
+                preempted = (ret == LUA_YIELD && scope.IsExceeded());
+            }
+
+            m_uResultCount = 0;
+            if (ret == LUA_YIELD)
+            {
+                if (preempted)
+                    return CoroutineStatus::Preempted;
+                m_uResultCount = static_cast<unsigned>(nres);
+                return CoroutineStatus::Yielded;
+            }
+
+            m_bDead = true;
+            if (ret != 0)
+            {
+                const char* msg = lua_tostring(co, -1);
+                luaL_traceback(co, co, msg, 0);
+                std::string errmsg = lua_tostring(co, -1);
+                lua_settop(co, 0);
+
+                return details::MakeError<CoroutineStatus>(std::move(errmsg), ret);
+            }
+            m_uResultCount = static_cast<unsigned>(nres);
+            return CoroutineStatus::Finished;
+        }
+
+        /**
+         * @brief 协程是否已经结束（正常结束或出错）
+         */
+        bool IsFinished()const noexcept { return m_bDead; }
+
+        /**
+         * @brief 获取上一次Resume让出或返回的值的个数
+         *
+         * 被抢占或出错时为0。
+         */
+        unsigned GetResultCount()const noexcept { return m_uResultCount; }
+
+    private:
+        // Lua 5.4起协程栈上可能残留被中断的函数的寄存器，只有栈顶的nres个值是结果
+        static int ResumeImpl(lua_State* co, unsigned nargs, int& nres)
+        {
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 504
+            return lua_resume(co, nullptr, static_cast<int>(nargs), &nres);
+#else
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 502
+            int ret = lua_resume(co, nullptr, static_cast<int>(nargs));
+#else
+            int ret = lua_resume(co, static_cast<int>(nargs));
+#endif
+            nres = lua_gettop(co);
+            return ret;
+#endif
+        }
+
+    private:
+        Reference m_stRef;
+        Stack m_stThread;
+        unsigned m_uResultCount = 0;
+        bool m_bDead = false;
+    };
+}
+}
@@ -4,6 +4,9 @@
  * @author chu
  */
 #pragma once
+#include <atomic>
+#include <sstream>
+
 #include "Stack.hpp"
 
 #if defined(__clang__)
@@ -30,6 +33,26 @@ namespace LuaWrapper
 {
     class Stack;
 
+    /**
+     * @brief 元方法
+     */
+    enum class MetaMethod
+    {
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        Unm,
+        Eq,
+        Lt,
+        Le,
+        Len,
+        Concat,
+        Call,
+        ToString,
+    };
+
     /**
      * @brief 类型注册器
      * @tparam T 类型
@@ -99,6 +122,35 @@ namespace LuaWrapper
             return *this;
         }
 
+        /**
+         * @brief 注册函数对象作为方法
+         * @param name 方法名称
+         * @param func 函数对象，第一个参数接收self
+         */
+        template <typename F>
+        typename std::enable_if<details::IsFunctorType<F>::value, TypeRegister&>::type
+        RegisterMethod(const char* name, F&& func)
+        {
+            m_stStack.Push(name);
+            m_stStack.Push(Callable(std::forward<F>(func)));
+            m_stStack.RawSet(m_iIndex);
+            return *this;
+        }
+
+        /**
+         * @brief 以同一名称注册多个重载
+         * @param name 方法名称
+         * @param f1 候选1
+         * @param f2 候选2
+         * @param funcs 其余候选
+         *
+         * 候选可以是成员函数、自由函数或函数对象，成员函数的self计入参数个数。
+         * 调用时按注册顺序选择第一个参数个数与参数类型均匹配的候选。
+         * 同名的C++重载函数需要先用static_cast选定签名。
+         */
+        template <typename F1, typename F2, typename... TFuncs>
+        TypeRegister& RegisterMethod(const char* name, F1&& f1, F2&& f2, TFuncs&&... funcs);
+
         /**
          * @brief 注册只读属性
          * @tparam TValue 值类型
@@ -168,11 +220,45 @@ namespace LuaWrapper
             return *this;
         }
 
+        /**
+         * @brief 使用C++运算符注册元方法
+         * @tparam Op 元方法，支持算术、比较运算与ToString
+         * @tparam TOther 另一个操作数的类型
+         *
+         * 生成的元方法会根据Lua传入参数的顺序调用`T op TOther`或`TOther op T`。
+         * 当结果为用户类型时，直接在userdata内构造结果。ToString使用operator<<输出。
+         */
+        template <MetaMethod Op, typename TOther = T>
+        TypeRegister& RegisterOperator();
+
+        /**
+         * @brief 使用函数注册元方法
+         * @tparam TFunc 函数类型
+         * @param op 元方法
+         * @param f 成员函数、自由函数或原生函数
+         *
+         * 参数按Lua调用元方法时的顺序传入。
+         */
+        template <typename TFunc>
+        TypeRegister& RegisterOperator(MetaMethod op, TFunc f);
+
     protected:
         Stack m_stStack;
         int m_iIndex = 0;
     };
 
+    /**
+     * @brief 类型是否需要注册__gc元方法
+     * @tparam T 类型
+     *
+     * 带有终结器的对象在回收时需要额外的GC轮次，因此默认只为非平凡析构的类型注册__gc。
+     * 可以特化此模板以强制开启。
+     */
+    template <typename T>
+    struct NeedsFinalizer :
+        public std::integral_constant<bool, !std::is_trivially_destructible<T>::value>
+    {};
+
     namespace details
     {
         template <class, template <class> class>
@@ -267,6 +353,12 @@ namespace LuaWrapper
         };
 #endif
 
+        inline int NextTypeIndex()noexcept
+        {
+            static std::atomic<int> s_iNext(0);
+            return ++s_iNext;
+        }
+
         template <typename T>
         struct TypeHelperImpl
         {
@@ -276,6 +368,15 @@ namespace LuaWrapper
                 return reinterpret_cast<uintptr_t>(&s_iStub);
             }
 
+            /**
+             * @brief 类型的连续整数编号，用作元表缓存的下标
+             */
+            static int TypeIndex()noexcept
+            {
+                static const int s_iIndex = NextTypeIndex();
+                return s_iIndex;
+            }
+
             static const char* TypeName()noexcept
             {
                 static const TypeNameConstructor<T> s_stName(TypeId());
@@ -295,13 +396,74 @@ namespace LuaWrapper
             //uintptr_t TypeId;
         };
 
+        /**
+         * @brief Lua对userdata内存保证的对齐
+         *
+         * 与LUAI_USER_ALIGNMENT_T一致，通常小于alignof(std::max_align_t)。
+         */
+        union UserDataAlignment
+        {
+            lua_Number Number;
+            double Double;
+            void* Pointer;
+            long Long;
+        };
+
+        template <typename T, bool OverAligned = (alignof(T) > alignof(UserDataAlignment))>
+        struct ObjectImpl;
+
         template <typename T>
-        struct ObjectImpl
+        struct ObjectImpl<T, false>
         {
             using Type = T;
 
             ObjectHeader Header;
             typename std::aligned_storage<sizeof(T), alignof(T)>::type Value;
+
+            static constexpr size_t AllocSize()noexcept
+            {
+                return sizeof(ObjectImpl);
+            }
+
+            void Init()noexcept
+            {
+            }
+
+            T* GetValue()noexcept
+            {
+                return reinterpret_cast<T*>(reinterpret_cast<char*>(&Value));
+            }
+        };
+
+        /**
+         * @brief 超对齐类型的对象
+         *
+         * lua_newuserdata无法满足对齐要求，因此额外分配空间并在其中对齐负载，偏移保存在头部。
+         */
+        template <typename T>
+        struct ObjectImpl<T, true>
+        {
+            using Type = T;
+
+            ObjectHeader Header;
+            uint32_t PayloadOffset;
+
+            static constexpr size_t AllocSize()noexcept
+            {
+                return sizeof(ObjectImpl) + sizeof(T) + alignof(T) - 1;
+            }
+
+            void Init()noexcept
+            {
+                auto self = reinterpret_cast<uintptr_t>(this);
+                auto payload = (self + sizeof(ObjectImpl) + alignof(T) - 1) & ~static_cast<uintptr_t>(alignof(T) - 1);
+                PayloadOffset = static_cast<uint32_t>(payload - self);
+            }
+
+            T* GetValue()noexcept
+            {
+                return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + PayloadOffset);
+            }
         };
 
         template <typename T>
@@ -309,22 +471,146 @@ namespace LuaWrapper
             ObjectImpl<RemoveCVType<T>>
         {};
 
-        // --- TypeRegisterHelper ---
+        // --- MetatableCache ---
+
+        /**
+         * @brief 元表缓存在注册表中的起始下标
+         *
+         * luaL_ref只分配正整数下标，因此各类型的元表缓存在注册表的负整数下标上，
+         * 获取元表只需一次lua_rawgeti，无需按类型名进行字符串查找。
+         */
+        static const int kMetatableSlotBase = -0x10000;
 
-        struct HasStaticMethodRegisterValidator
+        template <typename T>
+        int GetMetatableSlot()noexcept
         {
-            template <class T,
-                typename = typename std::decay<decltype(T::Register)>::type>
-            static std::true_type Test(int);
+            return kMetatableSlotBase - TypeHelper<T>::TypeIndex();
+        }
 
-            template <typename>
-            static std::false_type Test(...);
-        };
+        /**
+         * @brief 将缓存的元表压栈
+         * @return 元表是否存在，不存在时压入nil
+         *
+         * [-0, +1]
+         */
+        template <typename T>
+        bool PushCachedMetatable(lua_State* L)
+        {
+            lua_rawgeti(L, LUA_REGISTRYINDEX, GetMetatableSlot<T>());
+            return !lua_isnil(L, -1);
+        }
 
+        /**
+         * @brief 缓存给定位置上的元表
+         *
+         * [-0, +0]
+         */
         template <typename T>
-        struct HasStaticMethodRegister :
-            public decltype(HasStaticMethodRegisterValidator::template Test<T>(0))
-        {};
+        void SetCachedMetatable(lua_State* L, int idx)
+        {
+            lua_pushvalue(L, idx);
+            lua_rawseti(L, LUA_REGISTRYINDEX, GetMetatableSlot<T>());
+        }
+
+        // --- LazyType ---
+
+        /**
+         * @brief 延迟注册的类型的注册函数在注册表中的起始下标
+         *
+         * 注册函数以函数指针的形式存放在一个不带元表的userdata中，直到首次使用该类型时才构造元表。
+         */
+        static const int kLazyTypeSlotBase = -0x20000000;
+
+        template <typename T>
+        using LazyTypeBuilder = void(*)(TypeRegister<T>&);
+
+        template <typename T>
+        int GetLazyTypeSlot()noexcept
+        {
+            return kLazyTypeSlotBase - TypeHelper<T>::TypeIndex();
+        }
+
+        /**
+         * @brief 记录延迟注册函数
+         *
+         * [-0, +0]
+         */
+        template <typename T>
+        void SetLazyTypeBuilder(Stack& st, LazyTypeBuilder<T> builder)
+        {
+            auto p = st.NewUserData(sizeof(builder));
+            if (!p)
+                MOE_LUAWRP_THROW(std::bad_alloc());
+            ::memcpy(p, &builder, sizeof(builder));
+            lua_rawseti(st, LUA_REGISTRYINDEX, GetLazyTypeSlot<T>());
+        }
+
+        /**
+         * @brief 获取延迟注册函数
+         * @return 不存在时返回nullptr
+         *
+         * 注册函数执行成功后才应通过ClearLazyTypeBuilder清除，以便失败后仍能重试。
+         *
+         * [-0, +0]
+         */
+        template <typename T>
+        LazyTypeBuilder<T> GetLazyTypeBuilder(lua_State* L)
+        {
+            LazyTypeBuilder<T> builder = nullptr;
+            lua_rawgeti(L, LUA_REGISTRYINDEX, GetLazyTypeSlot<T>());
+            auto p = lua_touserdata(L, -1);
+            if (p)
+                ::memcpy(&builder, p, sizeof(builder));
+            lua_pop(L, 1);
+            return builder;
+        }
+
+        /**
+         * @brief 清除延迟注册函数
+         *
+         * [-0, +0]
+         */
+        template <typename T>
+        void ClearLazyTypeBuilder(lua_State* L)
+        {
+            lua_pushnil(L);
+            lua_rawseti(L, LUA_REGISTRYINDEX, GetLazyTypeSlot<T>());
+        }
+
+        // --- TestObject ---
+
+        /**
+         * @brief 检查栈上的值是否为给定用户类型
+         * @return 不是时返回nullptr
+         */
+        template <typename T>
+        Object<T>* TestObject(lua_State* L, int idx)
+        {
+            auto p = lua_touserdata(L, idx);
+            if (!p || !lua_getmetatable(L, idx))
+                return nullptr;
+
+            PushCachedMetatable<T>(L);
+            bool match = (lua_rawequal(L, -1, -2) != 0);
+            lua_pop(L, 2);
+            return match ? static_cast<Object<T>*>(p) : nullptr;
+        }
+
+        /**
+         * @brief 检查栈上的值是否为给定用户类型
+         *
+         * 类型不符时抛出Lua错误。
+         */
+        template <typename T>
+        Object<T>* CheckObject(lua_State* L, int idx)
+        {
+            auto p = TestObject<T>(L, idx);
+            if (!p)
+                luaL_typeerror(L, idx, TypeHelper<T>::TypeName());
+            return p;
+        }
+
+        // --- TypeRegisterHelper ---
 
         struct GenericRegisterFuncsBase
         {
@@ -402,14 +688,14 @@ namespace LuaWrapper
                 Stack st(L);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->~T();
+                p->GetValue()->~T();
                 return 0;
             }
 
@@ -418,9 +704,12 @@ namespace LuaWrapper
                 GenericRegisterFuncsBase::Register(st);
 
                 // 注册GC方法
-                st.Push("__gc");
-                st.Push(GCWrapper);
-                st.RawSet(-3);
+                if (NeedsFinalizer<T>::value)
+                {
+                    st.Push("__gc");
+                    st.Push(GCWrapper);
+                    st.RawSet(-3);
+                }
             }
         };
 
@@ -467,7 +756,7 @@ namespace LuaWrapper
                 HasStaticMethodRegister<T>::value,
                 TypeRegisterHelperImpl<T, 1>,
                 typename std::conditional<
-                    IsInstance<T, std::function>::value,
+                    IsInstance<T, std::function>::value || IsCallableWrapperType<T>::value,
                     TypeRegisterHelperImpl<T, 2>,
                     TypeRegisterHelperImpl<T, 0>>::type>
                 ::type
@@ -481,112 +770,102 @@ namespace LuaWrapper
         template <int... Ints, typename... TArgs>
         struct FunctionWrapper<StackIndexSeq<Ints...>, void, TArgs...>
         {
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
-                auto ptr = reinterpret_cast<void(*)(TArgs...)>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto ptr = reinterpret_cast<void(*)(TArgs...)>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(ptr);
 
-                try
+                MOE_LUAWRP_TRY
                 {
                     ptr(st.Read<TArgs>(Ints)...);
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, void(*f)(TArgs...))
             {
                 st.PushLightUserData(reinterpret_cast<void*>(f));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
         template <int... Ints, typename TRet, typename... TArgs>
         struct FunctionWrapper<StackIndexSeq<Ints...>, TRet, TArgs...>
         {
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
-                auto ptr = reinterpret_cast<TRet(*)(TArgs...)>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto ptr = reinterpret_cast<TRet(*)(TArgs...)>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(ptr);
 
-                try
+                MOE_LUAWRP_TRY
                 {
                     return st.Push(ptr(st.Read<TArgs>(Ints)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                    return 0;
-                }
+                MOE_LUAWRP_CATCH(st)
             }
 
             static void Push(Stack& st, TRet(*f)(TArgs...))
             {
                 st.PushLightUserData(reinterpret_cast<void*>(f));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
         template <int... Ints, typename... TArgs>
         struct FunctionWrapper<StackIndexSeq<Ints...>, void, Stack&, TArgs...>
         {
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
-                auto ptr = reinterpret_cast<void(*)(Stack&, TArgs...)>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto ptr = reinterpret_cast<void(*)(Stack&, TArgs...)>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(ptr);
 
-                try
+                MOE_LUAWRP_TRY
                 {
                     ptr(st, st.Read<TArgs>(Ints)...);
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, void(*f)(Stack&, TArgs...))
             {
                 st.PushLightUserData(reinterpret_cast<void*>(f));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
         template <int... Ints, typename TRet, typename... TArgs>
         struct FunctionWrapper<StackIndexSeq<Ints...>, TRet, Stack&, TArgs...>
         {
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
-                auto ptr = reinterpret_cast<TRet(*)(Stack&, TArgs...)>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto ptr = reinterpret_cast<TRet(*)(Stack&, TArgs...)>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(ptr);
 
-                try
+                MOE_LUAWRP_TRY
                 {
                     return st.Push(ptr(st, st.Read<TArgs>(Ints)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                    return 0;
-                }
+                MOE_LUAWRP_CATCH(st)
             }
 
             static void Push(Stack& st, TRet(*f)(Stack&, TArgs...))
             {
                 st.PushLightUserData(reinterpret_cast<void*>(f));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -603,41 +882,39 @@ namespace LuaWrapper
                 void(T::*Ptr)(TArgs...);
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
-                {
-                    (reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(st.Read<TArgs>(Ints + 1)...);
-                }
-                catch (const std::exception& ex)
+                MOE_LUAWRP_TRY
                 {
-                    st.Error("%s", ex.what());
+                    (p->GetValue()->*(w->Ptr))(st.Read<TArgs>(Ints + 1)...);
                 }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, void(T::*f)(TArgs...))
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -649,42 +926,39 @@ namespace LuaWrapper
                 TRet(T::*Ptr)(TArgs...);
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
+                MOE_LUAWRP_TRY
                 {
-                    return st.Push((reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(
+                    return st.Push((p->GetValue()->*(w->Ptr))(
                         st.Read<TArgs>(Ints + 1)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                    return 0;
-                }
+                MOE_LUAWRP_CATCH(st)
             }
 
             static void Push(Stack& st, TRet(T::*f)(TArgs...))
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -696,42 +970,40 @@ namespace LuaWrapper
                 void(T::*Ptr)(Stack&, TArgs...);
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
+                MOE_LUAWRP_TRY
                 {
-                    (reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(st,
+                    (p->GetValue()->*(w->Ptr))(st,
                         st.Read<TArgs>(Ints + 1)...);
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, void(T::*f)(Stack&, TArgs...))
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -743,42 +1015,39 @@ namespace LuaWrapper
                 TRet(T::*Ptr)(Stack&, TArgs...);
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
+                MOE_LUAWRP_TRY
                 {
-                    return st.Push((reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(st,
+                    return st.Push((p->GetValue()->*(w->Ptr))(st,
                         st.Read<TArgs>(Ints + 1)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                    return 0;
-                }
+                MOE_LUAWRP_CATCH(st)
             }
 
             static void Push(Stack& st, TRet(T::*f)(Stack&, TArgs...))
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -795,41 +1064,39 @@ namespace LuaWrapper
                 void(T::*Ptr)(TArgs...)const;
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
-                {
-                    (reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(st.Read<TArgs>(Ints + 1)...);
-                }
-                catch (const std::exception& ex)
+                MOE_LUAWRP_TRY
                 {
-                    st.Error("%s", ex.what());
+                    (p->GetValue()->*(w->Ptr))(st.Read<TArgs>(Ints + 1)...);
                 }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, void(T::*f)(TArgs...)const)
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -841,42 +1108,39 @@ namespace LuaWrapper
                 TRet(T::*Ptr)(TArgs...)const;
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
+                MOE_LUAWRP_TRY
                 {
-                    return st.Push((reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(
+                    return st.Push((p->GetValue()->*(w->Ptr))(
                         st.Read<TArgs>(Ints + 1)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                    return 0;
-                }
+                MOE_LUAWRP_CATCH(st)
             }
 
             static void Push(Stack& st, TRet(T::*f)(TArgs...)const)
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -888,42 +1152,40 @@ namespace LuaWrapper
                 void(T::*Ptr)(Stack&, TArgs...)const;
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
+                MOE_LUAWRP_TRY
                 {
-                    (reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(st,
+                    (p->GetValue()->*(w->Ptr))(st,
                         st.Read<TArgs>(Ints + 1)...);
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, void(T::*f)(Stack&, TArgs...)const)
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -935,42 +1197,39 @@ namespace LuaWrapper
                 TRet(T::*Ptr)(Stack&, TArgs...)const;
             };
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 
                 // 获得成员函数指针
-                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto w = static_cast<MemberPtrWrapper*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
                 assert(w);
 
                 // 对象
-                auto p = static_cast<Object<T>*>(luaL_checkudata(L, 1, TypeHelper<T>::TypeName()));
+                auto p = CheckObject<T>(L, 1);
                 if (!p)
                 {
                     assert(false);
                     return 0;
                 }
 
-                try
+                MOE_LUAWRP_TRY
                 {
-                    return st.Push((reinterpret_cast<T*>(reinterpret_cast<char*>(&p->Value))->*(w->Ptr))(st,
+                    return st.Push((p->GetValue()->*(w->Ptr))(st,
                         st.Read<TArgs>(Ints + 1)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                    return 0;
-                }
+                MOE_LUAWRP_CATCH(st)
             }
 
             static void Push(Stack& st, TRet(T::*f)(Stack&, TArgs...)const)
             {
-                auto p = static_cast<MemberPtrWrapper*>(lua_newuserdata(st, sizeof(MemberPtrWrapper)));  // upvalue 1
+                auto p = static_cast<MemberPtrWrapper*>(st.NewUserData(sizeof(MemberPtrWrapper)));  // upvalue 1
                 if (!p)
-                    throw std::bad_alloc();
+                    MOE_LUAWRP_THROW(std::bad_alloc());
 
                 p->Ptr = f;
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -984,33 +1243,31 @@ namespace LuaWrapper
         {
             using FuncType = std::function<void(TArgs...)>;
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 #ifndef NDEBUG
-                auto p = static_cast<Object<FuncType>*>(luaL_checkudata(L, lua_upvalueindex(1), TypeHelper<FuncType>::TypeName()));
+                auto p = CheckObject<FuncType>(L, lua_upvalueindex(UpValue));
                 assert(p);
 #else
-                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
 #endif
 
-                auto& obj = *reinterpret_cast<FuncType*>(reinterpret_cast<char*>(&p->Value));
-                try
+                auto& obj = *p->GetValue();
+                MOE_LUAWRP_TRY
                 {
                     if (obj)
                         obj(st.Read<TArgs>(Ints)...);
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, FuncType&& func)
             {
                 st.New<FuncType>(std::move(func));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -1019,33 +1276,31 @@ namespace LuaWrapper
         {
             using FuncType = std::function<TRet(TArgs...)>;
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 #ifndef NDEBUG
-                auto p = static_cast<Object<FuncType>*>(luaL_checkudata(L, lua_upvalueindex(1), TypeHelper<FuncType>::TypeName()));
+                auto p = CheckObject<FuncType>(L, lua_upvalueindex(UpValue));
                 assert(p);
 #else
-                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
 #endif
 
-                auto& obj = *reinterpret_cast<FuncType*>(reinterpret_cast<char*>(&p->Value));
-                try
+                auto& obj = *p->GetValue();
+                MOE_LUAWRP_TRY
                 {
                     if (obj)
                         return st.Push(obj(st.Read<TArgs>(Ints)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, FuncType&& func)
             {
                 st.New<FuncType>(std::move(func));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -1054,33 +1309,31 @@ namespace LuaWrapper
         {
             using FuncType = std::function<void(Stack&, TArgs...)>;
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 #ifndef NDEBUG
-                auto p = static_cast<Object<FuncType>*>(luaL_checkudata(L, lua_upvalueindex(1), TypeHelper<FuncType>::TypeName()));
+                auto p = CheckObject<FuncType>(L, lua_upvalueindex(UpValue));
                 assert(p);
 #else
-                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
 #endif
 
-                auto& obj = *reinterpret_cast<FuncType*>(reinterpret_cast<char*>(&p->Value));
-                try
+                auto& obj = *p->GetValue();
+                MOE_LUAWRP_TRY
                 {
                     if (obj)
                         obj(st, st.Read<TArgs>(Ints)...);
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, FuncType&& func)
             {
                 st.New<FuncType>(std::move(func));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
 
@@ -1089,134 +1342,897 @@ namespace LuaWrapper
         {
             using FuncType = std::function<TRet(Stack&, TArgs...)>;
 
+            template <int UpValue = 1>
             static int Wrapper(lua_State* L)
             {
                 Stack st(L);
 #ifndef NDEBUG
-                auto p = static_cast<Object<FuncType>*>(luaL_checkudata(L, lua_upvalueindex(1), TypeHelper<FuncType>::TypeName()));
+                auto p = CheckObject<FuncType>(L, lua_upvalueindex(UpValue));
                 assert(p);
 #else
-                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(1)));
+                auto p = static_cast<Object<FuncType>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
 #endif
 
-                auto& obj = *reinterpret_cast<FuncType*>(reinterpret_cast<char*>(&p->Value));
-                try
+                auto& obj = *p->GetValue();
+                MOE_LUAWRP_TRY
                 {
                     if (obj)
                         return st.Push(obj(st, st.Read<TArgs>(Ints)...));
                 }
-                catch (const std::exception& ex)
-                {
-                    st.Error("%s", ex.what());
-                }
+                MOE_LUAWRP_CATCH(st)
                 return 0;
             }
 
             static void Push(Stack& st, FuncType&& func)
             {
                 st.New<FuncType>(std::move(func));  // upvalue 1
-                st.PushNativeClosure(Wrapper, 1);
+                st.PushNativeClosure(Wrapper<>, 1);
             }
         };
     }
 
-    template <typename TRet, typename... TArgs>
-    int Stack::Push(TRet(*v)(TArgs...))
-    {
-        details::FunctionWrapper<typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, TRet, TArgs...>::
-            Push(*this, v);
-        return 1;
-    }
-
-    template <typename T, typename TRet, typename... TArgs>
-    int Stack::Push(TRet(T::*v)(TArgs...))
-    {
-        details::MemberFunctionWrapper<typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, T, TRet, TArgs...>::
-            Push(*this, std::move(v));
-        return 1;
-    }
-
-    template <typename T, typename TRet, typename... TArgs>
-    int Stack::Push(TRet(T::*v)(TArgs...)const)
-    {
-        details::ConstMemberFunctionWrapper<
-            typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, T, TRet, TArgs...>::Push(*this, std::move(v));
-        return 1;
-    }
-
-    template <typename T>
-    typename std::enable_if<details::IsOtherType<T>::value, int>::type Stack::Push(T&& rhs)
-    {
-        New<T>(std::forward<T>(rhs));
-        return 1;
-    }
-
-    template <typename TRet, typename... TArgs>
-    int Stack::Push(std::function<TRet(TArgs...)>&& v)
-    {
-        details::StdFunctionWrapper<typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, TRet, TArgs...>::Push(*this, std::move(v));
-        return 1;
-    }
-
-    template <typename T>
-    typename std::enable_if<std::is_class<typename std::decay<T>::type>::value && details::IsOtherType<T>::value, T>::type
-    Stack::Read(int idx)
+    namespace details
     {
-        auto p = static_cast<details::Object<T>*>(luaL_checkudata(L, idx, details::TypeHelper<T>::TypeName()));
-        assert(p);
+        // --- FunctorWrapper ---
 
-        return *reinterpret_cast<typename details::Object<T>::Type*>(reinterpret_cast<char*>(&p->Value));
-    }
+        template <class TSeq, typename F, typename TRet, typename... TArgs>
+        struct FunctorWrapper;
 
-    template <typename T, typename... TArgs>
-    typename std::enable_if<details::TypeRegisterHelper<typename details::Object<T>::Type>::CanAutoRegister, T&>::type
-    Stack::New(TArgs&&... args)
-    {
+        template <int... Ints, typename F, typename... TArgs>
+        struct FunctorWrapper<StackIndexSeq<Ints...>, F, void, TArgs...>
+        {
+            template <int UpValue = 1>
+            static int Wrapper(lua_State* L)
+            {
+                Stack st(L);
 #ifndef NDEBUG
-        int topCheck = lua_gettop(L);
+                auto p = CheckObject<CallableWrapper<F>>(L, lua_upvalueindex(UpValue));
+                assert(p);
+#else
+                auto p = static_cast<Object<CallableWrapper<F>>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
 #endif
 
-        using RealType = typename details::Object<T>::Type;
+                MOE_LUAWRP_TRY
+                {
+                    p->GetValue()->Func(st.Read<TArgs>(Ints)...);
+                }
+                MOE_LUAWRP_CATCH(st)
+                return 0;
+            }
 
-        // 构造对象
-        auto p = static_cast<details::Object<T>*>(lua_newuserdata(L, sizeof(details::Object<T>)));
-        if (!p)
-            throw std::bad_alloc();
+            template <typename TFunc>
+            static void Push(Stack& st, TFunc&& func)
+            {
+                st.New<CallableWrapper<F>>(std::forward<TFunc>(func));  // upvalue 1
+                st.PushNativeClosure(Wrapper<>, 1);
+            }
+        };
 
-        try
-        {
-            //p->Header.TypeId = details::TypeHelper<T>::TypeId();
-            new(&p->Value) RealType(std::forward<TArgs>(args)...);
-        }
-        catch (...)
+        template <int... Ints, typename F, typename TRet, typename... TArgs>
+        struct FunctorWrapper<StackIndexSeq<Ints...>, F, TRet, TArgs...>
         {
-            lua_pop(L, 1);
-
+            template <int UpValue = 1>
+            static int Wrapper(lua_State* L)
+            {
+                Stack st(L);
 #ifndef NDEBUG
-            assert(topCheck == lua_gettop(L));
+                auto p = CheckObject<CallableWrapper<F>>(L, lua_upvalueindex(UpValue));
+                assert(p);
+#else
+                auto p = static_cast<Object<CallableWrapper<F>>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
 #endif
-            throw;
-        }
 
-        auto ret = reinterpret_cast<RealType*>(reinterpret_cast<char*>(&p->Value));
+                MOE_LUAWRP_TRY
+                {
+                    return st.Push(p->GetValue()->Func(st.Read<TArgs>(Ints)...));
+                }
+                MOE_LUAWRP_CATCH(st)
+            }
 
-        // 如果对象未被注册，则调用方法进行注册
-        if (luaL_newmetatable(L, details::TypeHelper<T>::TypeName()))
-        {
-            try
+            template <typename TFunc>
+            static void Push(Stack& st, TFunc&& func)
             {
-                details::TypeRegisterHelper<RealType>::Register(*this);
+                st.New<CallableWrapper<F>>(std::forward<TFunc>(func));  // upvalue 1
+                st.PushNativeClosure(Wrapper<>, 1);
             }
-            catch (...)
-            {
-                ret->~RealType();
-                lua_pop(L, 2);
+        };
 
+        template <int... Ints, typename F, typename... TArgs>
+        struct FunctorWrapper<StackIndexSeq<Ints...>, F, void, Stack&, TArgs...>
+        {
+            template <int UpValue = 1>
+            static int Wrapper(lua_State* L)
+            {
+                Stack st(L);
 #ifndef NDEBUG
-                assert(topCheck == lua_gettop(L));
+                auto p = CheckObject<CallableWrapper<F>>(L, lua_upvalueindex(UpValue));
+                assert(p);
+#else
+                auto p = static_cast<Object<CallableWrapper<F>>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
+#endif
+
+                MOE_LUAWRP_TRY
+                {
+                    p->GetValue()->Func(st, st.Read<TArgs>(Ints)...);
+                }
+                MOE_LUAWRP_CATCH(st)
+                return 0;
+            }
+
+            template <typename TFunc>
+            static void Push(Stack& st, TFunc&& func)
+            {
+                st.New<CallableWrapper<F>>(std::forward<TFunc>(func));  // upvalue 1
+                st.PushNativeClosure(Wrapper<>, 1);
+            }
+        };
+
+        template <int... Ints, typename F, typename TRet, typename... TArgs>
+        struct FunctorWrapper<StackIndexSeq<Ints...>, F, TRet, Stack&, TArgs...>
+        {
+            template <int UpValue = 1>
+            static int Wrapper(lua_State* L)
+            {
+                Stack st(L);
+#ifndef NDEBUG
+                auto p = CheckObject<CallableWrapper<F>>(L, lua_upvalueindex(UpValue));
+                assert(p);
+#else
+                auto p = static_cast<Object<CallableWrapper<F>>*>(lua_touserdata(L, lua_upvalueindex(UpValue)));
+#endif
+
+                MOE_LUAWRP_TRY
+                {
+                    return st.Push(p->GetValue()->Func(st, st.Read<TArgs>(Ints)...));
+                }
+                MOE_LUAWRP_CATCH(st)
+            }
+
+            template <typename TFunc>
+            static void Push(Stack& st, TFunc&& func)
+            {
+                st.New<CallableWrapper<F>>(std::forward<TFunc>(func));  // upvalue 1
+                st.PushNativeClosure(Wrapper<>, 1);
+            }
+        };
+
+        template <typename F, typename TSig>
+        struct FunctorWrapperSelector;
+
+        template <typename F, typename C, typename TRet, typename... TArgs>
+        struct FunctorWrapperSelector<F, TRet(C::*)(TArgs...)> :
+            FunctorWrapper<typename MatchFuncArgsIndexSeq<TArgs...>::Type, F, TRet, TArgs...>
+        {};
+
+        template <typename F, typename C, typename TRet, typename... TArgs>
+        struct FunctorWrapperSelector<F, TRet(C::*)(TArgs...)const> :
+            FunctorWrapper<typename MatchFuncArgsIndexSeq<TArgs...>::Type, F, TRet, TArgs...>
+        {};
+
+        // --- OverloadWrapper ---
+
+        /**
+         * @brief 参数对应的Lua类型标签
+         *
+         * LUA_TNONE表示接受任意类型，LUA_TUSERDATA表示需要进一步比较元表。
+         */
+        template <typename T>
+        struct ArgTypeTag
+        {
+            using DecayType = typename std::decay<T>::type;
+
+            static const int value =
+                std::is_same<DecayType, bool>::value ? LUA_TBOOLEAN :
+                (std::is_arithmetic<DecayType>::value || IsSlotHandleType<DecayType>::value) ? LUA_TNUMBER :
+                (std::is_same<DecayType, const char*>::value || IsStdStringType<DecayType>::value ||
+                    IsStringViewType<DecayType>::value) ? LUA_TSTRING :
+                std::is_same<DecayType, std::nullptr_t>::value ? LUA_TNIL :
+                (std::is_same<DecayType, lua_CFunction>::value || IsStdFunctionTypeMatcher<DecayType>::value) ?
+                    LUA_TFUNCTION :
+                (std::is_class<DecayType>::value && IsOtherType<DecayType>::value) ? LUA_TUSERDATA :
+                LUA_TNONE;
+        };
+
+        template <typename T, int Tag = ArgTypeTag<T>::value>
+        struct ArgTypeMatcherImpl
+        {
+            static bool Match(lua_State* L, int idx)
+            {
+                return lua_type(L, idx) == Tag;
+            }
+        };
+
+        template <typename T>
+        struct ArgTypeMatcherImpl<T, LUA_TNONE>
+        {
+            static bool Match(lua_State*, int)
+            {
+                return true;
+            }
+        };
+
+        template <typename T>
+        struct ArgTypeMatcherImpl<T, LUA_TUSERDATA>
+        {
+            static bool Match(lua_State* L, int idx)
+            {
+                return TestObject<T>(L, idx) != nullptr;
+            }
+        };
+
+        template <typename T>
+        struct ArgTypeMatcher :
+            public ArgTypeMatcherImpl<typename std::decay<T>::type>
+        {};
+
+        template <typename T>
+        struct ArgTypeMatcherImpl<Optional<T>, LUA_TNONE>
+        {
+            static bool Match(lua_State* L, int idx)
+            {
+                return lua_isnoneornil(L, idx) || ArgTypeMatcher<T>::Match(L, idx);
+            }
+        };
+
+#ifdef MOE_LUAWRP_STD_OPTIONAL
+        template <typename T>
+        struct ArgTypeMatcherImpl<std::optional<T>, LUA_TNONE> :
+            public ArgTypeMatcherImpl<Optional<T>, LUA_TNONE>
+        {};
+#endif
+
+        template <typename... T>
+        struct AnyArgTypeMatcher;
+
+        template <>
+        struct AnyArgTypeMatcher<>
+        {
+            static bool Match(lua_State*, int)
+            {
+                return false;
+            }
+        };
+
+        template <typename T, typename... TRest>
+        struct AnyArgTypeMatcher<T, TRest...>
+        {
+            static bool Match(lua_State* L, int idx)
+            {
+                return ArgTypeMatcher<T>::Match(L, idx) || AnyArgTypeMatcher<TRest...>::Match(L, idx);
+            }
+        };
+
+        template <typename... T>
+        struct ArgTypeMatcherImpl<Variant<T...>, LUA_TNONE> :
+            public AnyArgTypeMatcher<T...>
+        {};
+
+        template <int Index, typename... TArgs>
+        struct ArgsMatcher;
+
+        template <int Index>
+        struct ArgsMatcher<Index>
+        {
+            static bool Match(lua_State*)
+            {
+                return true;
+            }
+        };
+
+        template <int Index, typename TArg, typename... TArgs>
+        struct ArgsMatcher<Index, TArg, TArgs...>
+        {
+            static bool Match(lua_State* L)
+            {
+                return ArgTypeMatcher<TArg>::Match(L, Index) && ArgsMatcher<Index + 1, TArgs...>::Match(L);
+            }
+        };
+
+        template <int Index, typename... TArgs>
+        struct ArgsMatcher<Index, VarArgs, TArgs...>
+        {
+            static_assert(sizeof...(TArgs) == 0, "VarArgs must be the last parameter");
+
+            static bool Match(lua_State*)
+            {
+                return true;
+            }
+        };
+
+        template <typename... TArgs>
+        struct IsVariadicArgs :
+            public std::false_type
+        {};
+
+        template <typename TArg, typename... TArgs>
+        struct IsVariadicArgs<TArg, TArgs...> :
+            public IsVariadicArgs<TArgs...>
+        {};
+
+        template <typename TArg>
+        struct IsVariadicArgs<TArg> :
+            public IsVarArgsType<TArg>
+        {};
+
+        template <typename... TArgs>
+        struct TrailingOptionalCount :
+            public std::integral_constant<int, 0>
+        {};
+
+        template <typename TArg, typename... TArgs>
+        struct TrailingOptionalCount<TArg, TArgs...> :
+            public std::integral_constant<int,
+                (IsOptionalType<TArg>::value && TrailingOptionalCount<TArgs...>::value == static_cast<int>(sizeof...(TArgs))) ?
+                    TrailingOptionalCount<TArgs...>::value + 1 : TrailingOptionalCount<TArgs...>::value>
+        {};
+
+        template <typename... TArgs>
+        struct OverloadArgs
+        {
+            static const bool Variadic = IsVariadicArgs<TArgs...>::value;
+
+            /**
+             * @brief 最多接受的参数个数（不含VarArgs）
+             */
+            static const int Arity = static_cast<int>(sizeof...(TArgs)) - (Variadic ? 1 : 0);
+
+            /**
+             * @brief 至少需要的参数个数，尾部的可选参数可以省略
+             */
+            static const int MinArity = Arity - TrailingOptionalCount<TArgs...>::value;
+
+            static bool MatchArity(int argc, int self)
+            {
+                return argc >= MinArity + self && (Variadic || argc <= Arity + self);
+            }
+
+            template <int Start>
+            static bool Match(lua_State* L)
+            {
+                return ArgsMatcher<Start, TArgs...>::Match(L);
+            }
+        };
+
+        template <typename... TArgs>
+        struct OverloadArgs<Stack&, TArgs...> :
+            OverloadArgs<TArgs...>
+        {};
+
+        template <class TWrapper, typename... TArgs>
+        struct FunctionOverloadTraits
+        {
+            using WrapperType = TWrapper;
+
+            static bool MatchArity(int argc)
+            {
+                return OverloadArgs<TArgs...>::MatchArity(argc, 0);
+            }
+
+            static bool Match(lua_State* L)
+            {
+                return OverloadArgs<TArgs...>::template Match<1>(L);
+            }
+        };
+
+        template <class TWrapper, typename T, typename... TArgs>
+        struct MethodOverloadTraits
+        {
+            using WrapperType = TWrapper;
+
+            static bool MatchArity(int argc)
+            {
+                return OverloadArgs<TArgs...>::MatchArity(argc, 1);
+            }
+
+            static bool Match(lua_State* L)
+            {
+                return TestObject<T>(L, 1) != nullptr && OverloadArgs<TArgs...>::template Match<2>(L);
+            }
+        };
+
+        template <typename F, typename TSig>
+        struct FunctorOverloadTraits;
+
+        template <typename F, typename C, typename TRet, typename... TArgs>
+        struct FunctorOverloadTraits<F, TRet(C::*)(TArgs...)> :
+            FunctionOverloadTraits<FunctorWrapperSelector<F, TRet(C::*)(TArgs...)>, TArgs...>
+        {};
+
+        template <typename F, typename C, typename TRet, typename... TArgs>
+        struct FunctorOverloadTraits<F, TRet(C::*)(TArgs...)const> :
+            FunctionOverloadTraits<FunctorWrapperSelector<F, TRet(C::*)(TArgs...)const>, TArgs...>
+        {};
+
+        /**
+         * @brief 重载候选的静态信息
+         *
+         * MatchArity检查Lua参数个数（不含Stack&，尾部的可选参数可以省略，末尾的VarArgs可匹配任意个），
+         * Match检查各参数的类型标签，
+         * WrapperType::Wrapper<UpValue>用于在指定upvalue上调用候选。
+         */
+        template <typename F, typename = void>
+        struct OverloadTraits;
+
+        template <typename TRet, typename... TArgs>
+        struct OverloadTraits<TRet(*)(TArgs...)> :
+            FunctionOverloadTraits<FunctionWrapper<typename MatchFuncArgsIndexSeq<TArgs...>::Type, TRet, TArgs...>,
+                TArgs...>
+        {};
+
+        template <typename T, typename TRet, typename... TArgs>
+        struct OverloadTraits<TRet(T::*)(TArgs...)> :
+            MethodOverloadTraits<MemberFunctionWrapper<typename MatchFuncArgsIndexSeq<TArgs...>::Type, T, TRet, TArgs...>,
+                T, TArgs...>
+        {};
+
+        template <typename T, typename TRet, typename... TArgs>
+        struct OverloadTraits<TRet(T::*)(TArgs...)const> :
+            MethodOverloadTraits<
+                ConstMemberFunctionWrapper<typename MatchFuncArgsIndexSeq<TArgs...>::Type, T, TRet, TArgs...>, T, TArgs...>
+        {};
+
+        template <typename TRet, typename... TArgs>
+        struct OverloadTraits<std::function<TRet(TArgs...)>> :
+            FunctionOverloadTraits<StdFunctionWrapper<typename MatchFuncArgsIndexSeq<TArgs...>::Type, TRet, TArgs...>,
+                TArgs...>
+        {};
+
+        template <typename F>
+        struct OverloadTraits<F, typename std::enable_if<IsFunctorType<F>::value>::type> :
+            FunctorOverloadTraits<F, decltype(&F::operator())>
+        {};
+
+        template <int UpValue, typename... TFuncs>
+        struct OverloadDispatcher;
+
+        template <int UpValue>
+        struct OverloadDispatcher<UpValue>
+        {
+            static int Dispatch(lua_State* L, int argc)
+            {
+                return luaL_error(L, "no matching overload for %d argument(s)", argc);
+            }
+        };
+
+        template <int UpValue, typename TFunc, typename... TFuncs>
+        struct OverloadDispatcher<UpValue, TFunc, TFuncs...>
+        {
+            static int Dispatch(lua_State* L, int argc)
+            {
+                using Traits = OverloadTraits<TFunc>;
+
+                if (Traits::MatchArity(argc) && Traits::Match(L))
+                    return Traits::WrapperType::template Wrapper<UpValue>(L);
+                return OverloadDispatcher<UpValue + 1, TFuncs...>::Dispatch(L, argc);
+            }
+        };
+
+        /**
+         * @brief 重载函数包装
+         * @tparam TFuncs 候选函数类型
+         *
+         * 每个候选的数据（函数指针、成员函数指针或函数对象）依次保存在upvalue中。
+         * 调用时先比较参数个数，再检查各参数的类型标签，调用第一个匹配的候选。
+         * 分派逻辑在编译期展开，调用过程中不涉及字符串操作。
+         */
+        template <typename... TFuncs>
+        struct OverloadWrapper
+        {
+            static int Wrapper(lua_State* L)
+            {
+                return OverloadDispatcher<1, TFuncs...>::Dispatch(L, lua_gettop(L));
+            }
+
+            template <typename... TArgs>
+            static void Push(Stack& st, TArgs&&... funcs)
+            {
+                static_assert(sizeof...(TFuncs) <= 255, "Too many overloads");
+
+                int expand[] = { (PushUpValue<TFuncs>(st, std::forward<TArgs>(funcs)), 0)... };
+                static_cast<void>(expand);
+                st.PushNativeClosure(Wrapper, sizeof...(TFuncs));
+            }
+
+        private:
+            template <typename TFunc, typename TArg>
+            static void PushUpValue(Stack& st, TArg&& func)
+            {
+                static_assert(!std::is_same<TFunc, lua_CFunction>::value, "Native functions can not be overloaded");
+
+                // 借助单个候选的闭包构造upvalue
+                PushCandidate<TFunc>(st, std::forward<TArg>(func));  // closure
+                auto ret = lua_getupvalue(st, -1, 1);  // closure upvalue
+                static_cast<void>(ret);
+                assert(ret);
+                lua_remove(st, -2);  // upvalue
+            }
+
+            template <typename TFunc, typename TArg>
+            static typename std::enable_if<IsFunctorType<TFunc>::value>::type PushCandidate(Stack& st, TArg&& func)
+            {
+                st.Push(Callable(TFunc(std::forward<TArg>(func))));
+            }
+
+            template <typename TFunc, typename TArg>
+            static typename std::enable_if<!IsFunctorType<TFunc>::value>::type PushCandidate(Stack& st, TArg&& func)
+            {
+                st.Push(TFunc(std::forward<TArg>(func)));
+            }
+        };
+
+        // --- InPlace ---
+
+        /**
+         * @brief 就地构造
+         *
+         * 作为New的唯一参数时，直接以工厂函数的返回值在userdata中构造对象，避免产生临时对象。
+         */
+        template <typename TFactory>
+        struct InPlace
+        {
+            TFactory& Factory;
+        };
+
+        template <typename TFactory>
+        InPlace<TFactory> MakeInPlace(TFactory& factory)noexcept
+        {
+            return InPlace<TFactory> { factory };
+        }
+
+        template <typename T, typename... TArgs>
+        void Construct(T* p, TArgs&&... args)
+        {
+            new(p) T(std::forward<TArgs>(args)...);
+        }
+
+        template <typename T, typename TFactory>
+        void Construct(T* p, InPlace<TFactory>&& factory)
+        {
+            new(p) T(factory.Factory());
+        }
+
+        // --- OperatorWrapper ---
+
+        template <MetaMethod Op>
+        struct MetaMethodTraits;
+
+#define MOE_LUAWRP_BINARY_OPERATOR(OP, NAME, EXPR) \
+        template <> \
+        struct MetaMethodTraits<MetaMethod::OP> \
+        { \
+            static const char* Name()noexcept { return NAME; } \
+            template <typename A, typename B> \
+            static auto Apply(const A& a, const B& b) -> decltype(EXPR) { return EXPR; } \
+        }
+
+        MOE_LUAWRP_BINARY_OPERATOR(Add, "__add", a + b);
+        MOE_LUAWRP_BINARY_OPERATOR(Sub, "__sub", a - b);
+        MOE_LUAWRP_BINARY_OPERATOR(Mul, "__mul", a * b);
+        MOE_LUAWRP_BINARY_OPERATOR(Div, "__div", a / b);
+        MOE_LUAWRP_BINARY_OPERATOR(Mod, "__mod", a % b);
+        MOE_LUAWRP_BINARY_OPERATOR(Eq, "__eq", a == b);
+        MOE_LUAWRP_BINARY_OPERATOR(Lt, "__lt", a < b);
+        MOE_LUAWRP_BINARY_OPERATOR(Le, "__le", a <= b);
+
+#undef MOE_LUAWRP_BINARY_OPERATOR
+
+        template <>
+        struct MetaMethodTraits<MetaMethod::Unm>
+        {
+            static const char* Name()noexcept { return "__unm"; }
+        };
+
+        template <>
+        struct MetaMethodTraits<MetaMethod::Len>
+        {
+            static const char* Name()noexcept { return "__len"; }
+        };
+
+        template <>
+        struct MetaMethodTraits<MetaMethod::Concat>
+        {
+            static const char* Name()noexcept { return "__concat"; }
+        };
+
+        template <>
+        struct MetaMethodTraits<MetaMethod::Call>
+        {
+            static const char* Name()noexcept { return "__call"; }
+        };
+
+        template <>
+        struct MetaMethodTraits<MetaMethod::ToString>
+        {
+            static const char* Name()noexcept { return "__tostring"; }
+        };
+
+        inline const char* GetMetaMethodName(MetaMethod op)noexcept
+        {
+            switch (op)
+            {
+                case MetaMethod::Add: return MetaMethodTraits<MetaMethod::Add>::Name();
+                case MetaMethod::Sub: return MetaMethodTraits<MetaMethod::Sub>::Name();
+                case MetaMethod::Mul: return MetaMethodTraits<MetaMethod::Mul>::Name();
+                case MetaMethod::Div: return MetaMethodTraits<MetaMethod::Div>::Name();
+                case MetaMethod::Mod: return MetaMethodTraits<MetaMethod::Mod>::Name();
+                case MetaMethod::Unm: return MetaMethodTraits<MetaMethod::Unm>::Name();
+                case MetaMethod::Eq: return MetaMethodTraits<MetaMethod::Eq>::Name();
+                case MetaMethod::Lt: return MetaMethodTraits<MetaMethod::Lt>::Name();
+                case MetaMethod::Le: return MetaMethodTraits<MetaMethod::Le>::Name();
+                case MetaMethod::Len: return MetaMethodTraits<MetaMethod::Len>::Name();
+                case MetaMethod::Concat: return MetaMethodTraits<MetaMethod::Concat>::Name();
+                case MetaMethod::Call: return MetaMethodTraits<MetaMethod::Call>::Name();
+                case MetaMethod::ToString: return MetaMethodTraits<MetaMethod::ToString>::Name();
+                default:
+                    assert(false);
+                    return "";
+            }
+        }
+
+        /**
+         * @brief 将运算结果压栈，用户类型在userdata内就地构造
+         */
+        template <typename TFactory>
+        typename std::enable_if<std::is_class<typename std::decay<decltype(std::declval<TFactory&>()())>::type>::value &&
+            IsOtherType<decltype(std::declval<TFactory&>()())>::value, int>::type
+        PushOperatorResult(Stack& st, TFactory& factory)
+        {
+            using ResultType = typename std::decay<decltype(factory())>::type;
+            st.New<ResultType>(MakeInPlace(factory));
+            return 1;
+        }
+
+        template <typename TFactory>
+        typename std::enable_if<!(std::is_class<typename std::decay<decltype(std::declval<TFactory&>()())>::type>::value &&
+            IsOtherType<decltype(std::declval<TFactory&>()())>::value), int>::type
+        PushOperatorResult(Stack& st, TFactory& factory)
+        {
+            return st.Push(factory());
+        }
+
+        template <typename T>
+        using OperandType = typename std::conditional<std::is_class<T>::value, const T&, T>::type;
+
+        template <MetaMethod Op, typename T, typename TOther>
+        struct BinaryOperatorWrapper
+        {
+            using Traits = MetaMethodTraits<Op>;
+
+            struct CanApplyReversedValidator
+            {
+                template <typename A, typename B,
+                    typename = decltype(Traits::Apply(std::declval<const A&>(), std::declval<const B&>()))>
+                static std::true_type Test(int);
+
+                template <typename, typename>
+                static std::false_type Test(...);
+            };
+
+            using CanApplyReversed = decltype(CanApplyReversedValidator::template Test<TOther, T>(0));
+
+            static int Reversed(Stack& st, std::true_type)
+            {
+                auto& rhs = *static_cast<Object<T>*>(lua_touserdata(st, 2))->GetValue();
+                auto&& lhs = st.Read<OperandType<TOther>>(1);
+                auto factory = [&]() { return Traits::Apply(lhs, rhs); };
+                return PushOperatorResult(st, factory);
+            }
+
+            static int Reversed(Stack& st, std::false_type)
+            {
+                st.Error("Unsupported operand order for %s", Traits::Name());
+                return 0;
+            }
+
+            static int Wrapper(lua_State* L)
+            {
+                Stack st(L);
+
+                MOE_LUAWRP_TRY
+                {
+                    auto self = TestObject<T>(L, 1);
+                    if (self)
+                    {
+                        const T& lhs = *self->GetValue();
+                        auto&& rhs = st.Read<OperandType<TOther>>(2);
+                        auto factory = [&]() { return Traits::Apply(lhs, rhs); };
+                        return PushOperatorResult(st, factory);
+                    }
+
+                    if (!TestObject<T>(L, 2))
+                        luaL_typeerror(L, 1, TypeHelper<T>::TypeName());
+                    return Reversed(st, CanApplyReversed());
+                }
+                MOE_LUAWRP_CATCH(st)
+            }
+        };
+
+        template <MetaMethod Op, typename T, typename TOther>
+        struct OperatorWrapper :
+            BinaryOperatorWrapper<Op, T, TOther>
+        {};
+
+        template <typename T, typename TOther>
+        struct OperatorWrapper<MetaMethod::Unm, T, TOther>
+        {
+            static int Wrapper(lua_State* L)
+            {
+                Stack st(L);
+                auto& self = *CheckObject<T>(L, 1)->GetValue();
+
+                MOE_LUAWRP_TRY
+                {
+                    auto factory = [&]() { return -self; };
+                    return PushOperatorResult(st, factory);
+                }
+                MOE_LUAWRP_CATCH(st)
+            }
+        };
+
+        template <typename T, typename TOther>
+        struct OperatorWrapper<MetaMethod::ToString, T, TOther>
+        {
+            static int Wrapper(lua_State* L)
+            {
+                Stack st(L);
+                auto& self = *CheckObject<T>(L, 1)->GetValue();
+
+                MOE_LUAWRP_TRY
+                {
+                    std::ostringstream ss;
+                    ss << self;
+                    return st.Push(ss.str());
+                }
+                MOE_LUAWRP_CATCH(st)
+            }
+        };
+    }
+
+    template <typename T>
+    template <MetaMethod Op, typename TOther>
+    TypeRegister<T>& TypeRegister<T>::RegisterOperator()
+    {
+        static_assert(Op != MetaMethod::Len && Op != MetaMethod::Concat && Op != MetaMethod::Call,
+            "No C++ operator maps to this metamethod, register a function instead");
+
+        m_stStack.Push(details::MetaMethodTraits<Op>::Name());
+        m_stStack.Push(details::OperatorWrapper<Op, T, TOther>::Wrapper);
+        m_stStack.RawSet(m_iIndex);
+        return *this;
+    }
+
+    template <typename T>
+    template <typename TFunc>
+    TypeRegister<T>& TypeRegister<T>::RegisterOperator(MetaMethod op, TFunc f)
+    {
+        m_stStack.Push(details::GetMetaMethodName(op));
+        m_stStack.Push(f);
+        m_stStack.RawSet(m_iIndex);
+        return *this;
+    }
+
+    template <typename T>
+    template <typename F1, typename F2, typename... TFuncs>
+    TypeRegister<T>& TypeRegister<T>::RegisterMethod(const char* name, F1&& f1, F2&& f2, TFuncs&&... funcs)
+    {
+        m_stStack.Push(name);
+        details::OverloadWrapper<typename std::decay<F1>::type, typename std::decay<F2>::type,
+            typename std::decay<TFuncs>::type...>::Push(m_stStack, std::forward<F1>(f1), std::forward<F2>(f2),
+            std::forward<TFuncs>(funcs)...);
+        m_stStack.RawSet(m_iIndex);
+        return *this;
+    }
+
+    template <typename TRet, typename... TArgs>
+    int Stack::Push(TRet(*v)(TArgs...))
+    {
+        details::FunctionWrapper<typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, TRet, TArgs...>::
+            Push(*this, v);
+        return 1;
+    }
+
+    template <typename T, typename TRet, typename... TArgs>
+    int Stack::Push(TRet(T::*v)(TArgs...))
+    {
+        details::MemberFunctionWrapper<typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, T, TRet, TArgs...>::
+            Push(*this, std::move(v));
+        return 1;
+    }
+
+    template <typename T, typename TRet, typename... TArgs>
+    int Stack::Push(TRet(T::*v)(TArgs...)const)
+    {
+        details::ConstMemberFunctionWrapper<
+            typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, T, TRet, TArgs...>::Push(*this, std::move(v));
+        return 1;
+    }
+
+    template <typename T>
+    typename std::enable_if<details::IsOtherType<T>::value, int>::type Stack::Push(T&& rhs)
+    {
+        New<T>(std::forward<T>(rhs));
+        return 1;
+    }
+
+    template <typename TRet, typename... TArgs>
+    int Stack::Push(std::function<TRet(TArgs...)>&& v)
+    {
+        details::StdFunctionWrapper<typename details::MatchFuncArgsIndexSeq<TArgs...>::Type, TRet, TArgs...>::Push(*this, std::move(v));
+        return 1;
+    }
+
+    template <typename F>
+    int Stack::Push(details::CallableWrapper<F>&& f)
+    {
+        details::FunctorWrapperSelector<F, decltype(&F::operator())>::Push(*this, std::move(f));
+        return 1;
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_class<typename std::decay<T>::type>::value && details::IsOtherType<T>::value, T>::type
+    Stack::Read(int idx)
+    {
+        auto p = details::CheckObject<T>(L, idx);
+        assert(p);
+
+        return *p->GetValue();
+    }
+
+    template <typename T, typename... TArgs>
+    typename std::enable_if<details::TypeRegisterHelper<typename details::Object<T>::Type>::CanAutoRegister, T&>::type
+    Stack::New(TArgs&&... args)
+    {
+#ifndef NDEBUG
+        int topCheck = lua_gettop(L);
 #endif
-                throw;
+
+        using RealType = typename details::Object<T>::Type;
+
+        // 构造对象
+        auto p = static_cast<details::Object<T>*>(NewUserData(details::Object<T>::AllocSize()));
+        if (!p)
+            MOE_LUAWRP_THROW(std::bad_alloc());
+        p->Init();
+
+        MOE_LUAWRP_TRY
+        {
+            //p->Header.TypeId = details::TypeHelper<T>::TypeId();
+            details::Construct(p->GetValue(), std::forward<TArgs>(args)...);
+        }
+        MOE_LUAWRP_CATCH_ALL
+        {
+            lua_pop(L, 1);
+
+#ifndef NDEBUG
+            assert(topCheck == lua_gettop(L));
+#endif
+            MOE_LUAWRP_RETHROW;
+        }
+
+        auto ret = p->GetValue();
+
+        // 获取元表，如果对象未被注册，则调用方法进行注册
+        if (!details::PushCachedMetatable<RealType>(L))
+        {
+            lua_pop(L, 1);
+            if (luaL_newmetatable(L, details::TypeHelper<T>::TypeName()))
+            {
+                MOE_LUAWRP_TRY
+                {
+                    details::TypeRegisterHelper<RealType>::Register(*this);
+                }
+                MOE_LUAWRP_CATCH_ALL
+                {
+                    ret->~RealType();
+                    lua_pop(L, 2);
+
+#ifndef NDEBUG
+                    assert(topCheck == lua_gettop(L));
+#endif
+                    MOE_LUAWRP_RETHROW;
+                }
             }
+            details::SetCachedMetatable<RealType>(L, -1);
         }
 
         // 设置元表
@@ -1239,38 +2255,78 @@ namespace LuaWrapper
         using RealType = typename details::Object<T>::Type;
 
         // 构造对象
-        auto p = static_cast<details::Object<T>*>(lua_newuserdata(L, sizeof(details::Object<T>)));
+        auto p = static_cast<details::Object<T>*>(NewUserData(details::Object<T>::AllocSize()));
         if (!p)
-            throw std::bad_alloc();
+            MOE_LUAWRP_THROW(std::bad_alloc());
+        p->Init();
 
-        try
+        MOE_LUAWRP_TRY
         {
             //p->Header.TypeId = details::TypeHelper<T>::TypeId();
-            new(&p->Value) RealType(std::forward<TArgs>(args)...);
+            details::Construct(p->GetValue(), std::forward<TArgs>(args)...);
         }
-        catch (...)
+        MOE_LUAWRP_CATCH_ALL
         {
             lua_pop(L, 1);
 
 #ifndef NDEBUG
             assert(topCheck == lua_gettop(L));
 #endif
-            throw;
+            MOE_LUAWRP_RETHROW;
         }
 
-        auto ret = reinterpret_cast<RealType*>(reinterpret_cast<char*>(&p->Value));
+        auto ret = p->GetValue();
 
-        // 获取元表
-        luaL_getmetatable(L, details::TypeHelper<T>::TypeName());
-        if (lua_isnil(L, -1))
+        // 获取元表，类型被延迟注册时在此构造
+        if (!details::PushCachedMetatable<RealType>(L))
         {
-            ret->~RealType();
-            lua_pop(L, 2);
+            lua_pop(L, 1);
+
+            auto builder = details::GetLazyTypeBuilder<RealType>(L);
+            if (!builder)
+            {
+                ret->~RealType();
+                lua_pop(L, 1);
 
 #ifndef NDEBUG
-            assert(topCheck == lua_gettop(L));
+                assert(topCheck == lua_gettop(L));
+#endif
+#ifdef MOE_LUAWRP_NO_EXCEPTIONS
+                Error("User type is not registered: %s", details::TypeHelper<T>::TypeName());
+#else
+                throw std::runtime_error(std::string("User type is not registered: ") + details::TypeHelper<T>::TypeName());
 #endif
-            throw std::runtime_error(std::string("User type is not registered: ") + details::TypeHelper<T>::TypeName());
+            }
+
+            bool created = luaL_newmetatable(L, details::TypeHelper<T>::TypeName()) != 0;
+
+            MOE_LUAWRP_TRY
+            {
+                if (created)
+                    details::GenericRegisterFuncs<RealType>::Register(*this);
+
+                TypeRegister<RealType> reg(*this, lua_gettop(L));
+                builder(reg);
+            }
+            MOE_LUAWRP_CATCH_ALL
+            {
+                // 撤销未完成的元表，保留注册函数以便下次重试
+                if (created)
+                {
+                    lua_pushnil(L);
+                    lua_setfield(L, LUA_REGISTRYINDEX, details::TypeHelper<T>::TypeName());
+                }
+
+                ret->~RealType();
+                lua_pop(L, 2);
+
+#ifndef NDEBUG
+                assert(topCheck == lua_gettop(L));
+#endif
+                MOE_LUAWRP_RETHROW;
+            }
+            details::SetCachedMetatable<RealType>(L, -1);
+            details::ClearLazyTypeBuilder<RealType>(L);
         }
 
         // 设置元表
@@ -1286,7 +2342,7 @@ namespace LuaWrapper
     typename std::enable_if<std::is_class<typename std::decay<T>::type>::value && details::IsOtherType<T>::value, bool>::type
     Stack::CheckType(int idx)
     {
-        return static_cast<details::Object<T>*>(luaL_checkudata(L, idx, details::TypeHelper<T>::TypeName())) != nullptr;
+        return details::CheckObject<T>(L, idx) != nullptr;
     }
 }
 }
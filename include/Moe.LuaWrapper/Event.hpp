@@ -0,0 +1,311 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include "Stack.hpp"
+#include "Reference.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    /**
+     * @brief 向多个Lua监听者广播的事件
+     * @tparam TArgs 事件参数
+     *
+     * 监听者保存在同一个Lua数组中。触发时参数只推入一次，之后通过lua_pushvalue复制给每个监听者，
+     * 错误处理函数也只安装一次。
+     *
+     * 触发期间可以安全地添加或删除监听者：新加入的监听者从下一次触发开始生效，被删除的监听者若尚未被调用则不再被调用。
+     */
+    template <typename... TArgs>
+    class Event
+    {
+    public:
+        Event()noexcept = default;
+
+        explicit Event(Stack& st)
+        {
+            lua_newtable(st);
+            m_stListeners = Reference::Capture(st);
+        }
+
+        Event(const Event&) = delete;
+        Event(Event&& rhs)noexcept
+            : m_stListeners(std::move(rhs.m_stListeners)), m_uSlots(rhs.m_uSlots), m_uCount(rhs.m_uCount),
+            m_uDispatchDepth(rhs.m_uDispatchDepth), m_bDirty(rhs.m_bDirty)
+        {
+            rhs.m_uSlots = rhs.m_uCount = rhs.m_uDispatchDepth = 0;
+            rhs.m_bDirty = false;
+        }
+
+        Event& operator=(const Event&) = delete;
+        Event& operator=(Event&& rhs)noexcept
+        {
+            m_stListeners = std::move(rhs.m_stListeners);
+            m_uSlots = rhs.m_uSlots;
+            m_uCount = rhs.m_uCount;
+            m_uDispatchDepth = rhs.m_uDispatchDepth;
+            m_bDirty = rhs.m_bDirty;
+            rhs.m_uSlots = rhs.m_uCount = rhs.m_uDispatchDepth = 0;
+            rhs.m_bDirty = false;
+            return *this;
+        }
+
+        operator bool()const noexcept { return static_cast<bool>(m_stListeners); }
+
+    public:
+        /**
+         * @brief 监听者个数
+         */
+        unsigned GetCount()const noexcept { return m_uCount; }
+
+        /**
+         * @brief 是否没有监听者
+         */
+        bool IsEmpty()const noexcept { return m_uCount == 0; }
+
+        /**
+         * @brief 添加栈顶的函数作为监听者
+         * @param st 堆栈
+         *
+         * [-1, +0]
+         */
+        void Add(Stack& st)
+        {
+            assert(m_stListeners);
+            assert(lua_type(st, -1) == LUA_TFUNCTION);
+
+            st.Push(m_stListeners);  // f t
+            lua_insert(st, -2);  // t f
+            lua_rawseti(st, -2, static_cast<int>(++m_uSlots));  // t
+            lua_pop(st, 1);
+            ++m_uCount;
+        }
+
+        /**
+         * @brief 添加监听者
+         * @param st 堆栈
+         * @param func 函数
+         */
+        void Add(Stack& st, const Reference& func)
+        {
+            st.Push(func);
+            Add(st);
+        }
+
+        /**
+         * @brief 删除栈顶的函数对应的监听者
+         * @param st 堆栈
+         * @return 未找到时返回false
+         *
+         * [-1, +0]
+         *
+         * 同一个函数被添加多次时只删除最早添加的一个。
+         */
+        bool Remove(Stack& st)
+        {
+            assert(m_stListeners);
+
+            bool found = false;
+            st.Push(m_stListeners);  // f t
+            for (unsigned i = 1; i <= m_uSlots; ++i)
+            {
+                lua_rawgeti(st, -1, static_cast<int>(i));  // f t v
+                found = (lua_rawequal(st, -1, -3) != 0);
+                lua_pop(st, 1);  // f t
+                if (found)
+                {
+                    // 先置为false，避免打乱正在进行的遍历
+                    lua_pushboolean(st, 0);
+                    lua_rawseti(st, -2, static_cast<int>(i));
+                    --m_uCount;
+                    m_bDirty = true;
+                    break;
+                }
+            }
+            lua_pop(st, 2);
+
+            if (found && m_uDispatchDepth == 0)
+                Compact(st);
+            return found;
+        }
+
+        /**
+         * @brief 删除监听者
+         * @param st 堆栈
+         * @param func 函数
+         * @return 未找到时返回false
+         */
+        bool Remove(Stack& st, const Reference& func)
+        {
+            st.Push(func);
+            return Remove(st);
+        }
+
+        /**
+         * @brief 删除所有监听者
+         * @param st 堆栈
+         */
+        void Clear(Stack& st)
+        {
+            assert(m_stListeners);
+
+            st.Push(m_stListeners);  // t
+            for (unsigned i = 1; i <= m_uSlots; ++i)
+            {
+                lua_pushboolean(st, 0);
+                lua_rawseti(st, -2, static_cast<int>(i));
+            }
+            lua_pop(st, 1);
+
+            m_uCount = 0;
+            m_bDirty = true;
+            if (m_uDispatchDepth == 0)
+                Compact(st);
+        }
+
+        /**
+         * @brief 触发事件
+         * @param st 堆栈
+         * @param args 参数
+         *
+         * 任一监听者出错时停止广播并抛出异常，无异常模式下返回错误。
+         */
+        Result<void> Fire(Stack& st, const TArgs&... args)
+        {
+            std::vector<BatchError> errors;
+            Dispatch(st, errors, true, args...);
+            if (!errors.empty())
+                return details::MakeError<void>(std::move(errors.front().Message), errors.front().Code);
+            return Result<void>();
+        }
+
+        /**
+         * @brief 触发事件，隔离各个监听者的错误
+         * @param st 堆栈
+         * @param errors 出错的监听者会追加到此处，Index为监听者被调用的次序
+         * @param args 参数
+         * @return 成功调用的监听者个数
+         *
+         * 单个监听者出错不会影响其他监听者。
+         */
+        size_t FireIsolated(Stack& st, std::vector<BatchError>& errors, const TArgs&... args)
+        {
+            return Dispatch(st, errors, false, args...);
+        }
+
+    private:
+        size_t Dispatch(Stack& st, std::vector<BatchError>& errors, bool stopOnError, const TArgs&... args)
+        {
+            assert(m_stListeners);
+
+#ifndef NDEBUG
+            unsigned topCheck = st.GetTop();
+#endif
+
+            if (m_uCount == 0)
+                return 0;
+
+            lua_pushcfunction(st, details::TracebackImpl);  // c
+            int handler = lua_gettop(st);
+            st.Push(m_stListeners);  // c t
+            int base = lua_gettop(st);
+
+            int expand[] = { 0, (st.Push(args), 0)... };  // c t arg1 arg2
+            static_cast<void>(expand);
+            int nargs = lua_gettop(st) - base;
+
+            if (!lua_checkstack(st, nargs + 1))
+            {
+                lua_settop(st, handler - 1);
+                MOE_LUAWRP_THROW(std::runtime_error("stack overflow"));
+            }
+
+            // 本次只调用触发前已存在的监听者
+            auto slots = m_uSlots;
+            size_t called = 0, succeeded = 0;
+            ++m_uDispatchDepth;
+            for (unsigned i = 1; i <= slots; ++i)
+            {
+                lua_rawgeti(st, base, static_cast<int>(i));  // c t arg1 arg2 f
+                if (lua_type(st, -1) != LUA_TFUNCTION)
+                {
+                    lua_pop(st, 1);
+                    continue;
+                }
+
+                for (int j = 1; j <= nargs; ++j)
+                    lua_pushvalue(st, base + j);  // c t arg1 arg2 f arg1 arg2
+
+                int ret = lua_pcall(st, nargs, 0, handler);  // c t arg1 arg2
+                if (0 != ret)
+                {
+                    auto msg = lua_tostring(st, -1);
+                    errors.emplace_back(called, msg ? msg : "(error object is not a string)", ret);
+                    lua_pop(st, 1);
+
+                    if (stopOnError)
+                        break;
+                }
+                else
+                {
+                    ++succeeded;
+                }
+                ++called;
+            }
+            --m_uDispatchDepth;
+
+            lua_settop(st, handler - 1);
+
+            if (m_bDirty && m_uDispatchDepth == 0)
+                Compact(st);
+
+#ifndef NDEBUG
+            assert(topCheck == st.GetTop());
+#endif
+            return succeeded;
+        }
+
+        void Compact(Stack& st)
+        {
+            st.Push(m_stListeners);  // t
+            unsigned j = 0;
+            for (unsigned i = 1; i <= m_uSlots; ++i)
+            {
+                lua_rawgeti(st, -1, static_cast<int>(i));  // t v
+                if (lua_type(st, -1) == LUA_TFUNCTION)
+                {
+                    if (++j != i)
+                        lua_rawseti(st, -2, static_cast<int>(j));  // t
+                    else
+                        lua_pop(st, 1);
+                }
+                else
+                {
+                    lua_pop(st, 1);
+                }
+            }
+            for (unsigned i = j + 1; i <= m_uSlots; ++i)
+            {
+                lua_pushnil(st);
+                lua_rawseti(st, -2, static_cast<int>(i));
+            }
+            lua_pop(st, 1);
+
+            m_uSlots = j;
+            m_bDirty = false;
+            assert(m_uSlots == m_uCount);
+        }
+
+    private:
+        Reference m_stListeners;
+        unsigned m_uSlots = 0;  // 数组长度，包含已删除的空位
+        unsigned m_uCount = 0;
+        unsigned m_uDispatchDepth = 0;
+        bool m_bDirty = false;
+    };
+}
+}
@@ -0,0 +1,553 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include <vector>
+#include <algorithm>
+
+#include "Details.hpp"
+#include "Reference.hpp"
+
+#ifdef LUAJIT_VERSION_NUM
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    namespace details
+    {
+        // --- FfiTypeName ---
+
+        /**
+         * @brief C++类型对应的FFI C类型名
+         *
+         * 未特化的类型无法用于FFI结构。
+         */
+        template <typename T>
+        struct FfiTypeName;
+
+#define MOE_LUAWRP_FFI_TYPE_NAME(TYPE, NAME) \
+        template <> \
+        struct FfiTypeName<TYPE> \
+        { \
+            static std::string Get() { return NAME; } \
+            static std::string Declare(const std::string& name) { return Get() + " " + name; } \
+        }
+
+        MOE_LUAWRP_FFI_TYPE_NAME(void, "void");
+        MOE_LUAWRP_FFI_TYPE_NAME(bool, "bool");
+        MOE_LUAWRP_FFI_TYPE_NAME(char, "char");
+        MOE_LUAWRP_FFI_TYPE_NAME(signed char, "signed char");
+        MOE_LUAWRP_FFI_TYPE_NAME(unsigned char, "unsigned char");
+        MOE_LUAWRP_FFI_TYPE_NAME(short, "short");
+        MOE_LUAWRP_FFI_TYPE_NAME(unsigned short, "unsigned short");
+        MOE_LUAWRP_FFI_TYPE_NAME(int, "int");
+        MOE_LUAWRP_FFI_TYPE_NAME(unsigned int, "unsigned int");
+        MOE_LUAWRP_FFI_TYPE_NAME(long, "long");
+        MOE_LUAWRP_FFI_TYPE_NAME(unsigned long, "unsigned long");
+        MOE_LUAWRP_FFI_TYPE_NAME(long long, "long long");
+        MOE_LUAWRP_FFI_TYPE_NAME(unsigned long long, "unsigned long long");
+        MOE_LUAWRP_FFI_TYPE_NAME(float, "float");
+        MOE_LUAWRP_FFI_TYPE_NAME(double, "double");
+
+#undef MOE_LUAWRP_FFI_TYPE_NAME
+
+        template <typename T>
+        struct FfiTypeName<const T>
+        {
+            static std::string Get() { return "const " + FfiTypeName<T>::Get(); }
+            static std::string Declare(const std::string& name) { return Get() + " " + name; }
+        };
+
+        template <typename T>
+        struct FfiTypeName<T*>
+        {
+            static std::string Get() { return FfiTypeName<T>::Get() + "*"; }
+            static std::string Declare(const std::string& name) { return Get() + " " + name; }
+        };
+
+        template <typename T, size_t N>
+        struct FfiTypeName<T[N]>
+        {
+            static std::string Declare(const std::string& name)
+            {
+                return FfiTypeName<T>::Declare(name + "[" + std::to_string(N) + "]");
+            }
+        };
+
+        template <typename... TArgs>
+        struct FfiArgsSignature;
+
+        template <>
+        struct FfiArgsSignature<>
+        {
+            static void Append(std::string&) {}
+        };
+
+        template <typename T, typename... TArgs>
+        struct FfiArgsSignature<T, TArgs...>
+        {
+            static void Append(std::string& out)
+            {
+                out.append(", ");
+                out.append(FfiTypeName<T>::Get());
+                FfiArgsSignature<TArgs...>::Append(out);
+            }
+        };
+
+        struct HasFfiTypeNameValidator
+        {
+            template <typename T>
+            static auto Test(int) -> decltype(FfiTypeName<T>::Get(), std::true_type());
+
+            template <typename T>
+            static std::false_type Test(...);
+        };
+
+        template <typename T>
+        struct HasFfiTypeName :
+            public decltype(HasFfiTypeNameValidator::template Test<T>(0))
+        {};
+
+        /**
+         * @brief 参数能否经由FFI传递，且与C API包装的行为一致
+         *
+         * bool不被接受：FFI只接受布尔值并把nil视为false，C API包装则接受数值并拒绝nil。
+         */
+        template <typename T>
+        struct IsFfiArgType :
+            public std::integral_constant<bool, HasFfiTypeName<T>::value && !std::is_same<T, bool>::value &&
+                (std::is_arithmetic<T>::value || std::is_same<T, const char*>::value)>
+        {};
+
+        /**
+         * @brief 返回值能否经由FFI传递，且与C API包装的行为一致
+         *
+         * 64位整数在FFI中会被装箱为cdata，字符串指针不会被转换为Lua字符串，因此均不被接受。
+         */
+        template <typename T>
+        struct IsFfiReturnType :
+            public std::integral_constant<bool, HasFfiTypeName<T>::value &&
+                (std::is_floating_point<T>::value || (std::is_integral<T>::value && sizeof(T) <= 4))>
+        {};
+
+        template <>
+        struct IsFfiReturnType<void> :
+            public std::true_type
+        {};
+
+        template <typename... TArgs>
+        struct AllFfiArgTypes;
+
+        template <>
+        struct AllFfiArgTypes<> :
+            public std::true_type
+        {};
+
+        template <typename T, typename... TArgs>
+        struct AllFfiArgTypes<T, TArgs...> :
+            public std::integral_constant<bool, IsFfiArgType<T>::value && AllFfiArgTypes<TArgs...>::value>
+        {};
+
+        // --- FfiThunk ---
+
+        /**
+         * @brief 将成员函数转换为以self指针为第一个参数的普通函数，供FFI通过函数指针调用
+         *
+         * 经由FFI调用时无法传递C++异常，被调用的方法不应抛出异常。
+         */
+        template <typename TFunc, TFunc F>
+        struct FfiThunk;
+
+        template <typename T, typename TRet, typename... TArgs, TRet(T::*F)(TArgs...)>
+        struct FfiThunk<TRet(T::*)(TArgs...), F>
+        {
+            static_assert(IsFfiReturnType<TRet>::value, "Return type is not supported by FFI method");
+            static_assert(AllFfiArgTypes<TArgs...>::value, "Argument type is not supported by FFI method");
+
+            static TRet Call(T* self, TArgs... args)
+            {
+                return (self->*F)(args...);
+            }
+
+            static std::string Signature(const std::string& self)
+            {
+                std::string ret = FfiTypeName<TRet>::Get() + " (*)(" + self + "*";
+                FfiArgsSignature<TArgs...>::Append(ret);
+                ret.append(")");
+                return ret;
+            }
+        };
+
+        template <typename T, typename TRet, typename... TArgs, TRet(T::*F)(TArgs...)const>
+        struct FfiThunk<TRet(T::*)(TArgs...)const, F>
+        {
+            static_assert(IsFfiReturnType<TRet>::value, "Return type is not supported by FFI method");
+            static_assert(AllFfiArgTypes<TArgs...>::value, "Argument type is not supported by FFI method");
+
+            static TRet Call(const T* self, TArgs... args)
+            {
+                return (self->*F)(args...);
+            }
+
+            static std::string Signature(const std::string& self)
+            {
+                std::string ret = FfiTypeName<TRet>::Get() + " (*)(const " + self + "*";
+                FfiArgsSignature<TArgs...>::Append(ret);
+                ret.append(")");
+                return ret;
+            }
+        };
+
+        // LuaJIT未在公开头文件中导出LUA_TCDATA
+        static const int kLuaTypeCData = 10;
+
+        // 参数：cdef, name, size, fields, methods
+        // 返回：ctype, 从指针拷贝构造cdata的函数, 从指针构造指针cdata的函数, 类型检查函数（1为值，2为指针，0为其他）
+        static const char kFfiDefineScript[] =
+            "local cdef, name, size, fields, methods = ...\n"
+            "local ffi = require('ffi')\n"
+            "ffi.cdef(cdef)\n"
+            "local ct = ffi.typeof(name)\n"
+            "if ffi.sizeof(ct) ~= size then\n"
+            "  error(string.format('size mismatch for %s: ffi %d, c++ %d', name, ffi.sizeof(ct), size))\n"
+            "end\n"
+            "for k, off in pairs(fields) do\n"
+            "  if ffi.offsetof(ct, k) ~= off then\n"
+            "    error(string.format('offset mismatch for %s.%s', name, k))\n"
+            "  end\n"
+            "end\n"
+            "local index = {}\n"
+            "for k, m in pairs(methods) do\n"
+            "  index[k] = ffi.cast(m[1], m[2])\n"
+            "end\n"
+            "ffi.metatype(ct, { __index = index })\n"
+            "local ptr, istype = ffi.typeof('$ *', ct), ffi.istype\n"
+            "return ct, function(p) return ct(ffi.cast(ptr, p)[0]) end, function(p) return ffi.cast(ptr, p) end,\n"
+            "  function(v) if istype(ptr, v) then return 2 elseif istype(ct, v) then return 1 end return 0 end\n";
+
+        // --- FfiFunction ---
+
+        // 参数：signature, pointer
+        // 返回：函数指针cdata，FFI不可用时返回nil
+        static const char kFfiCastScript[] =
+            "local sig, p = ...\n"
+            "local ok, ffi = pcall(require, 'ffi')\n"
+            "if not ok then return nil end\n"
+            "return ffi.cast(sig, p)\n";
+
+        /**
+         * @brief 尝试以FFI函数指针的形式推入函数
+         * @return 签名不兼容或FFI不可用时返回false，此时不推入任何值
+         */
+        template <typename TRet, typename... TArgs>
+        typename std::enable_if<IsFfiReturnType<TRet>::value && AllFfiArgTypes<TArgs...>::value, bool>::type
+        PushFfiFunction(Stack& st, TRet(*f)(TArgs...))
+        {
+            std::string args;
+            FfiArgsSignature<TArgs...>::Append(args);
+
+            std::string sig = FfiTypeName<TRet>::Get() + " (*)(";
+            sig.append(args.empty() ? std::string("void") : args.substr(2));
+            sig.append(")");
+
+            lua_State* L = st;
+            if (0 != luaL_loadbuffer(L, kFfiCastScript, sizeof(kFfiCastScript) - 1, "=PushFfiFunction"))
+            {
+                lua_pop(L, 1);
+                return false;
+            }
+            st.Push(sig);
+            lua_pushlightuserdata(L, reinterpret_cast<void*>(f));
+            if (0 != lua_pcall(L, 2, 1, 0) || lua_isnil(L, -1))
+            {
+                lua_pop(L, 1);
+                return false;
+            }
+            return true;
+        }
+
+        template <typename TRet, typename... TArgs>
+        typename std::enable_if<!(IsFfiReturnType<TRet>::value && AllFfiArgTypes<TArgs...>::value), bool>::type
+        PushFfiFunction(Stack&, TRet(*)(TArgs...))
+        {
+            return false;
+        }
+    }
+
+    /**
+     * @brief 通过LuaJIT FFI暴露的值类型
+     * @tparam T 类型
+     *
+     * 与userdata不同，对cdata的字段访问和方法调用可以被JIT编译。
+     */
+    template <typename T>
+    class FfiType
+    {
+        template <typename U>
+        friend class FfiTypeRegister;
+
+    public:
+        FfiType()noexcept = default;
+
+    public:
+        operator bool()const noexcept { return static_cast<bool>(m_stType); }
+
+        /**
+         * @brief 获取ctype对象，可以注册到Lua中用于构造cdata
+         */
+        const Reference& GetType()const noexcept { return m_stType; }
+
+        /**
+         * @brief 将值的拷贝作为cdata推入
+         * @param st 堆栈
+         * @param value 值
+         *
+         * [-0, +1]
+         */
+        void Push(Stack& st, const T& value)const
+        {
+            assert(m_stFromPointer);
+            st.Push(m_stFromPointer);
+            lua_pushlightuserdata(st, const_cast<T*>(&value));
+            lua_call(st, 1, 1);
+        }
+
+        /**
+         * @brief 将已有对象的指针作为T*类型的cdata推入
+         * @param st 堆栈
+         * @param value 对象指针，不能为nullptr
+         *
+         * [-0, +1]
+         *
+         * 不发生拷贝，脚本通过cdata直接读写C++持有的对象，字段访问与方法调用同样可以被JIT编译。
+         * cdata不会延长对象的生命周期，调用者需要保证脚本使用该cdata期间对象一直有效。
+         */
+        void PushPointer(Stack& st, T* value)const
+        {
+            assert(m_stFromRawPointer);
+            assert(value);
+            st.Push(m_stFromRawPointer);
+            lua_pushlightuserdata(st, value);
+            lua_call(st, 1, 1);
+        }
+
+        /**
+         * @brief 获取cdata的内存
+         * @param st 堆栈
+         * @param idx 索引
+         * @return 类型不符时返回nullptr
+         *
+         * 需要调用一次ffi.istype，仅适合在非热点路径中使用。
+         * 对于值cdata，返回的指针在cdata被回收前有效；对于指针cdata，返回其指向的对象。
+         */
+        T* Get(Stack& st, int idx)const
+        {
+            assert(m_stIsType);
+            if (lua_type(st, idx) != details::kLuaTypeCData)
+                return nullptr;
+
+            const void* p = lua_topointer(st, idx);
+            st.Push(m_stIsType);
+            lua_pushvalue(st, idx < 0 && idx > LUA_REGISTRYINDEX ? idx - 1 : idx);
+            lua_call(st, 1, 1);
+            auto kind = lua_tointeger(st, -1);
+            lua_pop(st, 1);
+
+            if (kind == 1)
+                return static_cast<T*>(const_cast<void*>(p));
+            else if (kind == 2)
+                return *static_cast<T* const*>(p);  // 指针cdata的内存中保存的是指针本身
+            return nullptr;
+        }
+
+    private:
+        Reference m_stType;
+        Reference m_stFromPointer;
+        Reference m_stFromRawPointer;
+        Reference m_stIsType;
+    };
+
+    /**
+     * @brief FFI结构注册器
+     * @tparam T 标准布局且可平凡复制的类型
+     *
+     * 根据登记的字段生成cdef，并以显式填充保证与C++的内存布局一致，定义时会校验大小与各字段的偏移。
+     * 方法被转换为以self指针为第一个参数的函数指针，挂在ctype的元表上。
+     */
+    template <typename T>
+    class FfiTypeRegister
+    {
+        static_assert(std::is_standard_layout<T>::value, "FFI type must be standard layout");
+        static_assert(std::is_trivially_copyable<T>::value, "FFI type must be trivially copyable");
+
+        struct FieldInfo
+        {
+            std::string Name;
+            std::string Declaration;
+            size_t Offset;
+            size_t Size;
+        };
+
+        struct MethodInfo
+        {
+            std::string Name;
+            std::string Signature;
+            void* Pointer;
+        };
+
+    public:
+        /**
+         * @param st 堆栈
+         * @param name C类型名，需要是合法的C标识符且未被cdef定义过
+         */
+        FfiTypeRegister(Stack& st, const char* name)
+            : m_stStack(st), m_stName(name) {}
+
+    public:
+        /**
+         * @brief 登记字段
+         * @param name 字段名
+         * @param field 成员指针
+         */
+        template <typename TField>
+        FfiTypeRegister& Field(const char* name, TField T::*field)
+        {
+            typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+            auto base = reinterpret_cast<const char*>(&storage);
+            auto member = reinterpret_cast<const char*>(&(reinterpret_cast<const T*>(base)->*field));
+
+            FieldInfo info;
+            info.Name = name;
+            info.Declaration = details::FfiTypeName<TField>::Declare(name);
+            info.Offset = static_cast<size_t>(member - base);
+            info.Size = sizeof(TField);
+            m_stFields.push_back(std::move(info));
+            return *this;
+        }
+
+        /**
+         * @brief 登记方法
+         * @tparam TFunc 成员函数类型
+         * @tparam F 成员函数
+         * @param name 方法名
+         *
+         * 用法：Method<decltype(&T::Foo), &T::Foo>("Foo")。参数与返回值的限制与RegisterFfiMethod相同，
+         * 参见IsFfiArgType与IsFfiReturnType。
+         */
+        template <typename TFunc, TFunc F>
+        FfiTypeRegister& Method(const char* name)
+        {
+            using Thunk = details::FfiThunk<TFunc, F>;
+
+            MethodInfo info;
+            info.Name = name;
+            info.Signature = Thunk::Signature(m_stName);
+            info.Pointer = reinterpret_cast<void*>(&Thunk::Call);
+            m_stMethods.push_back(std::move(info));
+            return *this;
+        }
+
+        /**
+         * @brief 生成cdef
+         */
+        std::string GetDefinition()const
+        {
+            auto fields = m_stFields;
+            std::sort(fields.begin(), fields.end(), [](const FieldInfo& a, const FieldInfo& b) {
+                return a.Offset < b.Offset;
+            });
+
+            std::string ret = "typedef struct {\n";
+            size_t offset = 0, pad = 0;
+            for (const auto& f : fields)
+            {
+                assert(f.Offset >= offset);  // 字段不能重叠
+                if (f.Offset > offset)
+                    ret.append("  uint8_t __pad" + std::to_string(pad++) + "[" + std::to_string(f.Offset - offset) + "];\n");
+                ret.append("  " + f.Declaration + ";\n");
+                offset = f.Offset + f.Size;
+            }
+            if (sizeof(T) > offset)
+                ret.append("  uint8_t __pad" + std::to_string(pad++) + "[" + std::to_string(sizeof(T) - offset) + "];\n");
+            ret.append("} " + m_stName + ";\n");
+            return ret;
+        }
+
+        /**
+         * @brief 定义FFI类型
+         * @return FFI类型
+         *
+         * 需要已加载package库。每个类型名只能定义一次。失败时抛出异常，无异常模式下返回错误。
+         */
+        Result<FfiType<T>> Commit()
+        {
+            lua_State* L = m_stStack;
+#ifndef NDEBUG
+            unsigned topCheck = m_stStack.GetTop();
+#endif
+
+            lua_pushcfunction(L, details::TracebackImpl);  // c
+            int handler = lua_gettop(L);
+
+            int ret = luaL_loadbuffer(L, details::kFfiDefineScript, sizeof(details::kFfiDefineScript) - 1,
+                "=FfiTypeRegister");  // c f
+            if (ret == 0)
+            {
+                m_stStack.Push(GetDefinition());
+                m_stStack.Push(m_stName);
+                m_stStack.Push(static_cast<lua_Number>(sizeof(T)));
+
+                lua_createtable(L, 0, static_cast<int>(m_stFields.size()));  // c f cdef name size fields
+                for (const auto& f : m_stFields)
+                {
+                    lua_pushnumber(L, static_cast<lua_Number>(f.Offset));
+                    lua_setfield(L, -2, f.Name.c_str());
+                }
+
+                lua_createtable(L, 0, static_cast<int>(m_stMethods.size()));  // c f cdef name size fields methods
+                for (const auto& m : m_stMethods)
+                {
+                    lua_createtable(L, 2, 0);
+                    m_stStack.Push(m.Signature);
+                    lua_rawseti(L, -2, 1);
+                    lua_pushlightuserdata(L, m.Pointer);
+                    lua_rawseti(L, -2, 2);
+                    lua_setfield(L, -2, m.Name.c_str());
+                }
+
+                ret = lua_pcall(L, 5, 4, handler);  // c ct from fromptr istype
+            }
+
+            if (ret != 0)
+            {
+                std::string errmsg = lua_tostring(L, -1);
+                lua_settop(L, handler - 1);
+                return details::MakeError<FfiType<T>>(std::move(errmsg), ret);
+            }
+
+            FfiType<T> type;
+            type.m_stIsType = Reference::Capture(m_stStack);
+            type.m_stFromRawPointer = Reference::Capture(m_stStack);
+            type.m_stFromPointer = Reference::Capture(m_stStack);
+            type.m_stType = Reference::Capture(m_stStack);
+            lua_pop(L, 1);
+
+#ifndef NDEBUG
+            assert(topCheck == m_stStack.GetTop());
+#endif
+            return type;
+        }
+
+    private:
+        Stack m_stStack;
+        std::string m_stName;
+        std::vector<FieldInfo> m_stFields;
+        std::vector<MethodInfo> m_stMethods;
+    };
+}
+}
+
+#endif
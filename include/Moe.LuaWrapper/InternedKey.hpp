@@ -0,0 +1,105 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include "Stack.hpp"
+#include "Reference.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    /**
+     * @brief 预先驻留的字符串key
+     *
+     * 构造时将字符串驻留到Lua中并保存引用，此后通过lua_rawgeti取回，
+     * 访问字段时无需再计算长度与哈希。仅可用于创建它的State（及其线程）。
+     */
+    class InternedKey
+    {
+        friend class Stack;
+
+    public:
+        InternedKey()noexcept = default;
+
+        InternedKey(Stack& st, const char* key)
+        {
+            lua_pushstring(st, key);
+            m_stRef = Reference::Capture(st);
+        }
+
+        InternedKey(Stack& st, const char* key, size_t length)
+        {
+            lua_pushlstring(st, key, length);
+            m_stRef = Reference::Capture(st);
+        }
+
+        InternedKey(Stack& st, const std::string& key)
+            : InternedKey(st, key.c_str(), key.size()) {}
+
+    public:
+        operator bool()const noexcept { return static_cast<bool>(m_stRef); }
+
+    public:
+        bool IsEmpty()const noexcept { return m_stRef.IsEmpty(); }
+
+    private:
+        Reference m_stRef;
+    };
+
+    inline int Stack::Push(const InternedKey& v)
+    {
+        assert(v);
+        return Push(v.m_stRef);
+    }
+
+    inline void Stack::GetField(int idx, const InternedKey& field)
+    {
+        if (idx < 0 && idx > LUA_REGISTRYINDEX)
+            idx = lua_gettop(L) + idx + 1;
+
+        Push(field);
+        lua_gettable(L, idx);
+    }
+
+    inline void Stack::SetField(int idx, const InternedKey& field)
+    {
+        if (idx < 0 && idx > LUA_REGISTRYINDEX)
+            idx = lua_gettop(L) + idx + 1;
+
+        Push(field);  // v k
+        lua_insert(L, -2);  // k v
+        lua_settable(L, idx);
+    }
+
+    inline void Stack::GetGlobal(const InternedKey& field)
+    {
+#ifdef LUA_GLOBALSINDEX
+        Push(field);
+        lua_gettable(L, LUA_GLOBALSINDEX);
+#else
+        lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);  // g
+        Push(field);  // g k
+        lua_gettable(L, -2);  // g v
+        lua_remove(L, -2);  // v
+#endif
+    }
+
+    inline void Stack::SetGlobal(const InternedKey& field)
+    {
+#ifdef LUA_GLOBALSINDEX
+        Push(field);  // v k
+        lua_insert(L, -2);  // k v
+        lua_settable(L, LUA_GLOBALSINDEX);
+#else
+        lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);  // v g
+        Push(field);  // v g k
+        lua_pushvalue(L, -3);  // v g k v
+        lua_settable(L, -3);  // v g
+        lua_pop(L, 2);
+#endif
+    }
+}
+}
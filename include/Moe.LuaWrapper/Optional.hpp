@@ -0,0 +1,301 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include <new>
+
+#include "Details.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    /**
+     * @brief 可选值
+     * @tparam T 值类型
+     *
+     * 作为参数时，nil或缺省的参数读取为空值，因此可以用于可省略的尾部参数。
+     * C++17下亦可直接使用std::optional。
+     */
+    template <typename T>
+    class Optional
+    {
+    public:
+        using ValueType = T;
+
+    public:
+        Optional()noexcept = default;
+
+        Optional(const T& value)
+        {
+            new(&m_stStorage) T(value);
+            m_bHasValue = true;
+        }
+
+        Optional(T&& value)
+        {
+            new(&m_stStorage) T(std::move(value));
+            m_bHasValue = true;
+        }
+
+        Optional(const Optional& rhs)
+        {
+            if (rhs.m_bHasValue)
+            {
+                new(&m_stStorage) T(*rhs);
+                m_bHasValue = true;
+            }
+        }
+
+        Optional(Optional&& rhs)
+        {
+            if (rhs.m_bHasValue)
+            {
+                new(&m_stStorage) T(std::move(*rhs));
+                m_bHasValue = true;
+            }
+        }
+
+        ~Optional()
+        {
+            Reset();
+        }
+
+        Optional& operator=(const Optional& rhs)
+        {
+            if (this != &rhs)
+            {
+                Reset();
+                if (rhs.m_bHasValue)
+                {
+                    new(&m_stStorage) T(*rhs);
+                    m_bHasValue = true;
+                }
+            }
+            return *this;
+        }
+
+        Optional& operator=(Optional&& rhs)
+        {
+            if (this != &rhs)
+            {
+                Reset();
+                if (rhs.m_bHasValue)
+                {
+                    new(&m_stStorage) T(std::move(*rhs));
+                    m_bHasValue = true;
+                }
+            }
+            return *this;
+        }
+
+        operator bool()const noexcept { return m_bHasValue; }
+
+        T& operator*()noexcept
+        {
+            assert(m_bHasValue);
+            return *reinterpret_cast<T*>(&m_stStorage);
+        }
+
+        const T& operator*()const noexcept
+        {
+            assert(m_bHasValue);
+            return *reinterpret_cast<const T*>(&m_stStorage);
+        }
+
+        T* operator->()noexcept { return &**this; }
+        const T* operator->()const noexcept { return &**this; }
+
+    public:
+        /**
+         * @brief 是否有值
+         */
+        bool HasValue()const noexcept { return m_bHasValue; }
+
+        /**
+         * @brief 获取值，为空时返回给定的默认值
+         * @param def 默认值
+         */
+        T ValueOr(T def)const
+        {
+            return m_bHasValue ? **this : std::move(def);
+        }
+
+        /**
+         * @brief 清空
+         */
+        void Reset()noexcept
+        {
+            if (m_bHasValue)
+            {
+                reinterpret_cast<T*>(&m_stStorage)->~T();
+                m_bHasValue = false;
+            }
+        }
+
+    private:
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_stStorage;
+        bool m_bHasValue = false;
+    };
+
+    namespace details
+    {
+        template <typename T>
+        struct OptionalValueType;
+
+        template <typename T>
+        struct OptionalValueType<Optional<T>>
+        {
+            using Type = T;
+        };
+
+#ifdef MOE_LUAWRP_STD_OPTIONAL
+        template <typename T>
+        struct OptionalValueType<std::optional<T>>
+        {
+            using Type = T;
+        };
+#endif
+
+        // --- DefaultArgsFunctor ---
+
+        template <int First, typename TDefaults>
+        struct DefaultArgsReader
+        {
+            template <int I, typename T>
+            static auto Read(const VarArgs& args, TDefaults&, std::false_type)
+                -> typename ReadResult<T>::Type
+            {
+                return args.template Get<T>(I);
+            }
+
+            template <int I, typename T>
+            static auto Read(const VarArgs& args, TDefaults& defaults, std::true_type)
+                -> typename ReadResult<T>::Type
+            {
+                auto type = args.TypeOf(I);
+                if (type == LUA_TNONE || type == LUA_TNIL)
+                    return std::get<I - First>(defaults);
+                return args.template Get<T>(I);
+            }
+        };
+
+        template <class TSeq, typename TFunc, typename TDefaults>
+        struct DefaultArgsFunctor;
+
+        template <int... Ints, typename TRet, typename... TArgs, typename... TDefaults>
+        struct DefaultArgsFunctor<StackIndexSeq<Ints...>, TRet(*)(TArgs...), std::tuple<TDefaults...>>
+        {
+            static const int kFirstDefault = static_cast<int>(sizeof...(TArgs) - sizeof...(TDefaults));
+            using Reader = DefaultArgsReader<kFirstDefault, std::tuple<TDefaults...>>;
+
+            TRet(*Func)(TArgs...);
+            std::tuple<TDefaults...> Defaults;
+
+            DefaultArgsFunctor(TRet(*f)(TArgs...), std::tuple<TDefaults...>&& defaults)
+                : Func(f), Defaults(std::move(defaults)) {}
+
+            TRet operator()(VarArgs args)
+            {
+                return Func(Reader::template Read<Ints - 1, TArgs>(args, Defaults,
+                    std::integral_constant<bool, (Ints - 1 >= kFirstDefault)>())...);
+            }
+        };
+
+        template <int... Ints, typename T, typename TRet, typename... TArgs, typename... TDefaults>
+        struct DefaultArgsFunctor<StackIndexSeq<Ints...>, TRet(T::*)(TArgs...), std::tuple<TDefaults...>>
+        {
+            static const int kFirstDefault = static_cast<int>(sizeof...(TArgs) - sizeof...(TDefaults));
+            using Reader = DefaultArgsReader<kFirstDefault, std::tuple<TDefaults...>>;
+
+            TRet(T::*Func)(TArgs...);
+            std::tuple<TDefaults...> Defaults;
+
+            DefaultArgsFunctor(TRet(T::*f)(TArgs...), std::tuple<TDefaults...>&& defaults)
+                : Func(f), Defaults(std::move(defaults)) {}
+
+            TRet operator()(T& self, VarArgs args)
+            {
+                return (self.*Func)(Reader::template Read<Ints - 1, TArgs>(args, Defaults,
+                    std::integral_constant<bool, (Ints - 1 >= kFirstDefault)>())...);
+            }
+        };
+
+        template <int... Ints, typename T, typename TRet, typename... TArgs, typename... TDefaults>
+        struct DefaultArgsFunctor<StackIndexSeq<Ints...>, TRet(T::*)(TArgs...)const, std::tuple<TDefaults...>>
+        {
+            static const int kFirstDefault = static_cast<int>(sizeof...(TArgs) - sizeof...(TDefaults));
+            using Reader = DefaultArgsReader<kFirstDefault, std::tuple<TDefaults...>>;
+
+            TRet(T::*Func)(TArgs...)const;
+            std::tuple<TDefaults...> Defaults;
+
+            DefaultArgsFunctor(TRet(T::*f)(TArgs...)const, std::tuple<TDefaults...>&& defaults)
+                : Func(f), Defaults(std::move(defaults)) {}
+
+            TRet operator()(const T& self, VarArgs args)
+            {
+                return (self.*Func)(Reader::template Read<Ints - 1, TArgs>(args, Defaults,
+                    std::integral_constant<bool, (Ints - 1 >= kFirstDefault)>())...);
+            }
+        };
+    }
+
+    /**
+     * @brief 为函数的尾部参数指定默认值
+     * @param f 自由函数或成员函数
+     * @param defaults 最后sizeof...(defaults)个参数的默认值
+     * @return 可直接用于RegisterMethod的函数对象
+     *
+     * 对应参数为nil或缺省时使用默认值。
+     */
+    template <typename TRet, typename... TArgs, typename... TDefaults>
+    details::DefaultArgsFunctor<typename details::MakeStackIndexSeq<sizeof...(TArgs)>::Type, TRet(*)(TArgs...),
+        std::tuple<typename std::decay<TDefaults>::type...>>
+    WithDefaults(TRet(*f)(TArgs...), TDefaults&&... defaults)
+    {
+        static_assert(sizeof...(TDefaults) <= sizeof...(TArgs), "Too many default values");
+        return { f, std::make_tuple(std::forward<TDefaults>(defaults)...) };
+    }
+
+    template <typename T, typename TRet, typename... TArgs, typename... TDefaults>
+    details::DefaultArgsFunctor<typename details::MakeStackIndexSeq<sizeof...(TArgs)>::Type, TRet(T::*)(TArgs...),
+        std::tuple<typename std::decay<TDefaults>::type...>>
+    WithDefaults(TRet(T::*f)(TArgs...), TDefaults&&... defaults)
+    {
+        static_assert(sizeof...(TDefaults) <= sizeof...(TArgs), "Too many default values");
+        return { f, std::make_tuple(std::forward<TDefaults>(defaults)...) };
+    }
+
+    template <typename T, typename TRet, typename... TArgs, typename... TDefaults>
+    details::DefaultArgsFunctor<typename details::MakeStackIndexSeq<sizeof...(TArgs)>::Type, TRet(T::*)(TArgs...)const,
+        std::tuple<typename std::decay<TDefaults>::type...>>
+    WithDefaults(TRet(T::*f)(TArgs...)const, TDefaults&&... defaults)
+    {
+        static_assert(sizeof...(TDefaults) <= sizeof...(TArgs), "Too many default values");
+        return { f, std::make_tuple(std::forward<TDefaults>(defaults)...) };
+    }
+
+    template <typename T>
+    typename std::enable_if<details::IsOptionalType<T>::value, int>::type Stack::Push(const T& rhs)
+    {
+        if (rhs)
+            return Push(*rhs);
+        lua_pushnil(L);
+        return 1;
+    }
+
+    template <typename T>
+    typename std::enable_if<details::IsOptionalType<T>::value, typename std::decay<T>::type>::type Stack::Read(int idx)
+    {
+        using OptionalType = typename std::decay<T>::type;
+        using ValueType = typename details::OptionalValueType<OptionalType>::Type;
+
+        if (lua_isnoneornil(L, idx))
+            return OptionalType();
+        return OptionalType(Read<ValueType>(idx));
+    }
+}
+}
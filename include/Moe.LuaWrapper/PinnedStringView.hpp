@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include "Stack.hpp"
+#include "Reference.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    /**
+     * @brief 固定生命周期的字符串视图
+     *
+     * 通过注册表引用持有Lua字符串，因此在离开调用栈后视图依然有效，且读取时不产生拷贝。
+     * 仅在参数只需在当次调用中使用时，直接使用StringView即可，无需引用的开销。
+     */
+    class PinnedStringView
+    {
+        friend class Stack;
+
+    public:
+        PinnedStringView()noexcept = default;
+
+    public:
+        operator bool()const noexcept { return static_cast<bool>(m_stRef); }
+        operator const StringView&()const noexcept { return m_stView; }
+
+#ifdef MOE_LUAWRP_STD_STRING_VIEW
+        operator std::string_view()const noexcept
+        {
+            return std::string_view(m_stView.Buffer, m_stView.Length);
+        }
+#endif
+
+        char operator[](size_t idx)const noexcept
+        {
+            assert(idx < m_stView.Length);
+            return m_stView.Buffer[idx];
+        }
+
+    public:
+        /**
+         * @brief 是否为空
+         */
+        bool IsEmpty()const noexcept { return m_stRef.IsEmpty(); }
+
+        /**
+         * @brief 获取字符串内存
+         *
+         * Lua字符串总以'\0'结尾。
+         */
+        const char* GetBuffer()const noexcept { return m_stView.Buffer; }
+
+        /**
+         * @brief 获取字符串长度
+         */
+        size_t GetLength()const noexcept { return m_stView.Length; }
+
+        /**
+         * @brief 获取视图
+         */
+        const StringView& GetView()const noexcept { return m_stView; }
+
+        /**
+         * @brief 拷贝为std::string
+         */
+        std::string ToString()const
+        {
+            return m_stView.ToString();
+        }
+
+    private:
+        StringView m_stView;
+        Reference m_stRef;
+    };
+
+    inline bool operator==(const PinnedStringView& lhs, const PinnedStringView& rhs)noexcept
+    {
+        return lhs.GetView() == rhs.GetView();
+    }
+
+    inline bool operator!=(const PinnedStringView& lhs, const PinnedStringView& rhs)noexcept
+    {
+        return lhs.GetView() != rhs.GetView();
+    }
+
+    inline bool operator<(const PinnedStringView& lhs, const PinnedStringView& rhs)noexcept
+    {
+        return lhs.GetView() < rhs.GetView();
+    }
+
+    inline int Stack::Push(const PinnedStringView& v)
+    {
+        return Push(v.m_stRef);
+    }
+
+    template <typename T>
+    typename std::enable_if<std::is_same<typename std::decay<T>::type, PinnedStringView>::value, PinnedStringView>::type
+    Stack::Read(int idx)
+    {
+        PinnedStringView ret;
+        ret.m_stView.Buffer = luaL_checklstring(L, idx, &ret.m_stView.Length);  // 数字会被就地转换为字符串
+        lua_pushvalue(L, idx);
+        ret.m_stRef = Reference::Capture(*this);
+        return ret;
+    }
+}
+}
+
+namespace std
+{
+    template <>
+    struct hash<moe::LuaWrapper::PinnedStringView>
+    {
+        size_t operator()(const moe::LuaWrapper::PinnedStringView& v)const noexcept
+        {
+            return hash<moe::LuaWrapper::StringView>()(v.GetView());
+        }
+    };
+}
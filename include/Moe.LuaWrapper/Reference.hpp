@@ -32,8 +32,7 @@ namespace LuaWrapper
 #endif
 
 #ifdef LUA_RIDX_MAINTHREAD
-            st.Push<int>(LUA_RIDX_MAINTHREAD);  // ? i
-            st.RawGet(LUA_REGISTRYINDEX);  // ? t
+            lua_rawgeti(st, LUA_REGISTRYINDEX, LUA_RIDX_MAINTHREAD);  // ? t
 #else
             st.Push("__mainthread");  // ? s
             st.RawGet(LUA_REGISTRYINDEX);  // ? t
@@ -0,0 +1,396 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include "Stack.hpp"
+#include "Reference.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    namespace details
+    {
+        /**
+         * @brief 沙盒中需要包装返回值的基础函数
+         *
+         * 这些函数会直接返回共享的表（例如字符串的元表、已加载的模块），需要将返回值同样替换为只读视图。
+         */
+        static const char* const kSandboxWrappedFuncs[] = { "getmetatable", "require" };
+
+        inline void PushSandboxView(lua_State* L, int cache, bool root);
+
+        inline int SandboxReadOnlyError(lua_State* L)
+        {
+            return luaL_error(L, "attempt to modify a read-only table");
+        }
+
+        // upvalue: f cache
+        inline int SandboxWrappedCall(lua_State* L)
+        {
+            int nargs = lua_gettop(L);
+            lua_pushvalue(L, lua_upvalueindex(1));  // ... f
+            lua_insert(L, 1);  // f ...
+            lua_call(L, nargs, LUA_MULTRET);  // ...
+
+            int nrets = lua_gettop(L);
+            for (int i = 1; i <= nrets; ++i)
+            {
+                lua_pushvalue(L, i);  // ... v
+                PushSandboxView(L, lua_upvalueindex(2), false);  // ... p
+                lua_replace(L, i);  // ...
+            }
+            return nrets;
+        }
+
+        // upvalue: t cache root
+        inline int SandboxIndex(lua_State* L)
+        {
+            lua_settop(L, 2);  // p k
+            lua_pushvalue(L, 2);  // p k k
+            lua_gettable(L, lua_upvalueindex(1));  // p k v
+
+            if (lua_toboolean(L, lua_upvalueindex(3)) && lua_isfunction(L, -1) && lua_type(L, 2) == LUA_TSTRING)
+            {
+                auto key = lua_tostring(L, 2);
+                for (auto name : kSandboxWrappedFuncs)
+                {
+                    if (::strcmp(key, name) != 0)
+                        continue;
+
+                    // 包装后的函数同样缓存在cache中，保证多次访问得到同一个函数
+                    lua_pushvalue(L, -1);  // p k v v
+                    lua_rawget(L, lua_upvalueindex(2));  // p k v w
+                    if (lua_isnil(L, -1))
+                    {
+                        lua_pop(L, 1);  // p k v
+                        lua_pushvalue(L, -1);  // p k v v
+                        lua_pushvalue(L, lua_upvalueindex(2));  // p k v v cache
+                        lua_pushcclosure(L, SandboxWrappedCall, 2);  // p k v w
+                        lua_pushvalue(L, -2);  // p k v w v
+                        lua_pushvalue(L, -2);  // p k v w v w
+                        lua_rawset(L, lua_upvalueindex(2));  // p k v w
+                    }
+                    return 1;
+                }
+            }
+
+            PushSandboxView(L, lua_upvalueindex(2), false);  // p k v
+            return 1;
+        }
+
+        // upvalue: t cache
+        inline int SandboxNext(lua_State* L)
+        {
+            lua_settop(L, 2);  // p k
+            if (!lua_next(L, lua_upvalueindex(1)))  // p k v
+            {
+                lua_pushnil(L);
+                return 1;
+            }
+            PushSandboxView(L, lua_upvalueindex(2), false);  // p k v
+            return 2;
+        }
+
+        // upvalue: t cache
+        inline int SandboxPairs(lua_State* L)
+        {
+            lua_pushvalue(L, lua_upvalueindex(1));
+            lua_pushvalue(L, lua_upvalueindex(2));
+            lua_pushcclosure(L, SandboxNext, 2);  // f
+            lua_pushvalue(L, 1);  // f p
+            lua_pushnil(L);  // f p nil
+            return 3;
+        }
+
+        // upvalue: t
+        inline int SandboxLen(lua_State* L)
+        {
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 502
+            lua_pushinteger(L, static_cast<lua_Integer>(lua_rawlen(L, lua_upvalueindex(1))));
+#else
+            lua_pushinteger(L, static_cast<lua_Integer>(lua_objlen(L, lua_upvalueindex(1))));
+#endif
+            return 1;
+        }
+
+        /**
+         * @brief 将栈顶的值替换为只读视图
+         * @param cache 缓存表的索引，必须是绝对索引或伪索引
+         * @param root 是否为基础环境本身
+         *
+         * [-1, +1]
+         *
+         * 非表的值保持不变。视图是一张空表，读取时回退到真实的表并递归地包装其中的表，写入时报错。
+         * 同一张表在同一个cache中只会生成一个视图。
+         */
+        inline void PushSandboxView(lua_State* L, int cache, bool root)
+        {
+            if (!lua_istable(L, -1))
+                return;
+
+            lua_pushvalue(L, -1);  // t t
+            lua_rawget(L, cache);  // t p
+            if (!lua_isnil(L, -1))
+            {
+                lua_remove(L, -2);  // p
+                return;
+            }
+            lua_pop(L, 1);  // t
+
+            lua_newtable(L);  // t p
+            lua_createtable(L, 0, 5);  // t p mt
+            lua_pushvalue(L, -3);
+            lua_pushvalue(L, cache);
+            lua_pushboolean(L, root ? 1 : 0);
+            lua_pushcclosure(L, SandboxIndex, 3);  // t p mt f
+            lua_setfield(L, -2, "__index");  // t p mt
+            lua_pushcfunction(L, SandboxReadOnlyError);  // t p mt f
+            lua_setfield(L, -2, "__newindex");  // t p mt
+            lua_pushvalue(L, -3);
+            lua_pushvalue(L, cache);
+            lua_pushcclosure(L, SandboxPairs, 2);  // t p mt f
+            lua_setfield(L, -2, "__pairs");  // t p mt
+            lua_pushvalue(L, -3);
+            lua_pushcclosure(L, SandboxLen, 1);  // t p mt f
+            lua_setfield(L, -2, "__len");  // t p mt
+            lua_pushboolean(L, 0);  // t p mt false
+            lua_setfield(L, -2, "__metatable");  // t p mt
+            lua_setmetatable(L, -2);  // t p
+
+            lua_pushvalue(L, -2);  // t p t
+            lua_pushvalue(L, -2);  // t p t p
+            lua_rawset(L, cache);  // t p
+            lua_remove(L, -2);  // p
+        }
+    }
+
+    /**
+     * @brief 沙盒环境
+     *
+     * 每个沙盒持有一张独立的环境表，未定义的全局变量通过__index回退到共享的基础环境（默认为全局表），
+     * 因此多个租户可以共享同一个State以及其中注册的类型与模块。
+     * 脚本对全局变量的赋值只写入自己的环境表，_G指向环境表本身，环境表的元表受__metatable保护。
+     *
+     * 基础环境以只读视图的形式提供给脚本：其中的表（例如string、math）被递归地替换为代理表，写入时报错，
+     * getmetatable和require的返回值同样经过包装，因此一个租户无法修改其他租户看到的库函数。
+     * 视图按沙盒分别创建，rawset只会影响租户自己的视图。代价是访问库表时多一次C函数调用，
+     * 并且在Lua 5.1与LuaJIT上pairs、ipairs与#无法遍历视图。
+     *
+     * 视图无法限制基础环境中的函数本身的行为：load、loadstring、dofile等加载的chunk、getfenv以及debug库
+     * 仍然可以取得真实的全局表，运行不可信的脚本时应在基础环境中移除这些函数。
+     */
+    class Sandbox
+    {
+    public:
+        /**
+         * @brief 以全局表的只读视图为基础环境创建沙盒
+         * @param st 堆栈
+         * @return 沙盒对象
+         */
+        static Sandbox Create(Stack& st)
+        {
+            st.PushGlobalTable();  // g
+            return CreateImpl(st);
+        }
+
+        /**
+         * @brief 以给定的表的只读视图为基础环境创建沙盒
+         * @param st 堆栈
+         * @param base 基础环境
+         * @return 沙盒对象
+         */
+        static Sandbox Create(Stack& st, const Reference& base)
+        {
+            st.Push(base);  // g
+            return CreateImpl(st);
+        }
+
+    public:
+        Sandbox()noexcept = default;
+
+        Sandbox(const Sandbox&) = delete;
+        Sandbox(Sandbox&&)noexcept = default;
+
+        Sandbox& operator=(const Sandbox&) = delete;
+        Sandbox& operator=(Sandbox&&)noexcept = default;
+
+    public:
+        operator bool()const noexcept
+        {
+            return !m_stEnv.IsEmpty();
+        }
+
+        /**
+         * @brief 获取环境表
+         *
+         * 可以通过环境表为单个租户注入变量。
+         */
+        const Reference& GetEnvironment()const noexcept { return m_stEnv; }
+
+        /**
+         * @brief 将沙盒设置为函数的执行环境
+         * @param st 堆栈
+         * @param idx 函数的索引
+         * @return 无法设置时返回false，此时函数仍使用原来的环境，调用者必须检查返回值
+         *
+         * [-0, +0]
+         *
+         * 参见Stack::SetFunctionEnvironment。加载新的chunk时应使用LoadBuffer或LoadString。
+         */
+        bool Apply(Stack& st, int idx)
+        {
+            assert(m_stEnv);
+
+            if (idx < 0 && idx > LUA_REGISTRYINDEX)
+                idx = static_cast<int>(st.GetTop()) + idx + 1;
+            st.Push(m_stEnv);  // e
+            return st.SetFunctionEnvironment(idx);
+        }
+
+        /**
+         * @brief 在沙盒中加载缓冲区
+         * @param st 堆栈
+         * @param content 内容
+         * @param name 名称
+         *
+         * [-0, +1]
+         *
+         * 只接受文本形式的chunk，预编译的字节码会被拒绝。
+         * 当加载失败时，抛出异常。无异常模式下返回错误，栈保持不变。
+         */
+        Result<void> LoadBuffer(Stack& st, const std::string& content, const char* name="")
+        {
+            return LoadImpl(st, content.c_str(), content.size(), name);
+        }
+
+        /**
+         * @brief 在沙盒中从字符串编译
+         * @param st 堆栈
+         * @param content 内容
+         *
+         * [-0, +1]
+         *
+         * 只接受文本形式的chunk，预编译的字节码会被拒绝。
+         * 当编译失败时抛出异常。无异常模式下返回错误，栈保持不变。
+         */
+        Result<void> LoadString(Stack& st, const char* content)
+        {
+            return LoadImpl(st, content, ::strlen(content), content);
+        }
+
+        /**
+         * @brief 清空环境表
+         * @param st 堆栈
+         *
+         * 删除脚本定义的所有全局变量，之后可以复用同一个沙盒。已经绑定到沙盒的函数仍然使用该环境表。
+         */
+        void Clear(Stack& st)
+        {
+            assert(m_stEnv);
+
+#ifndef NDEBUG
+            unsigned topCheck = st.GetTop();
+#endif
+
+            st.Push(m_stEnv);  // e
+            lua_pushnil(st);  // e nil
+            while (lua_next(st, -2))  // e k v
+            {
+                lua_pop(st, 1);  // e k
+                lua_pushvalue(st, -1);  // e k k
+                lua_pushnil(st);  // e k k nil
+                lua_rawset(st, -4);  // e k
+            }
+            lua_pushvalue(st, -1);  // e e
+            lua_setfield(st, -2, "_G");  // e
+            lua_pop(st, 1);
+
+#ifndef NDEBUG
+            assert(topCheck == st.GetTop());
+#endif
+        }
+
+    private:
+        // [-0, +1]
+        Result<void> LoadImpl(Stack& st, const char* buffer, size_t size, const char* name)
+        {
+            assert(m_stEnv);
+
+#if (defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 502) || defined(LUAJIT_VERSION_NUM)
+            int ret = luaL_loadbufferx(st, buffer, size, name, "t");
+#else
+            // Lua 5.1没有加载模式，手动拒绝字节码
+            if (size > 0 && buffer[0] == LUA_SIGNATURE[0])
+                return details::MakeError<void>("attempt to load a binary chunk", LUA_ERRSYNTAX);
+            int ret = luaL_loadbuffer(st, buffer, size, name);
+#endif
+            if (0 != ret)
+            {
+                std::string errmsg = lua_tostring(st, -1);
+                lua_pop(st, 1);
+
+                return details::MakeError<void>(std::move(errmsg), ret);
+            }
+
+            // 新加载的chunk的第一个上值总是_ENV，不依赖调试信息
+            st.Push(m_stEnv);  // f e
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM < 502
+            bool bound = lua_setfenv(st, -2) != 0;  // f
+#else
+            bool bound = lua_setupvalue(st, -2, 1) != nullptr;  // f
+            if (!bound)
+                lua_pop(st, 1);
+#endif
+            if (!bound)
+            {
+                lua_pop(st, 1);
+                return details::MakeError<void>("Cannot bind the chunk to the sandbox");
+            }
+            return Result<void>();
+        }
+
+        // [-1, +0]
+        static Sandbox CreateImpl(Stack& st)
+        {
+#ifndef NDEBUG
+            unsigned topCheck = st.GetTop();
+#endif
+
+            // 每个沙盒使用独立的视图缓存，键为真实的表
+            lua_newtable(st);  // g cache
+            lua_createtable(st, 0, 1);  // g cache mt
+            lua_pushliteral(st, "k");  // g cache mt "k"
+            lua_setfield(st, -2, "__mode");  // g cache mt
+            lua_setmetatable(st, -2);  // g cache
+            lua_insert(st, -2);  // cache g
+            details::PushSandboxView(st, static_cast<int>(st.GetTop()) - 1, true);  // cache b
+            lua_remove(st, -2);  // b
+
+            lua_newtable(st);  // b e
+            lua_createtable(st, 0, 2);  // b e mt
+            lua_pushvalue(st, -3);  // b e mt b
+            lua_setfield(st, -2, "__index");  // b e mt
+            lua_pushboolean(st, 0);  // b e mt false
+            lua_setfield(st, -2, "__metatable");  // b e mt
+            lua_setmetatable(st, -2);  // b e
+            lua_pushvalue(st, -1);  // b e e
+            lua_setfield(st, -2, "_G");  // b e
+            lua_remove(st, -2);  // e
+
+            Sandbox ret;
+            ret.m_stEnv = Reference::Capture(st);
+
+#ifndef NDEBUG
+            assert(topCheck == st.GetTop() + 1);
+#endif
+            return ret;
+        }
+
+    private:
+        Reference m_stEnv;
+    };
+}
+}
@@ -0,0 +1,393 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include <vector>
+#include <algorithm>
+
+#include "Details.hpp"
+#include "Optional.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    /**
+     * @brief 句柄
+     *
+     * 由槽位下标与代数组成，打包后共52位，可以无损地存放在lua_Number中。
+     * 槽位被释放后代数随之改变，因此可以检测出过期的句柄。
+     */
+    class SlotHandle
+    {
+    public:
+        static const unsigned kGenerationBits = 20;
+        static const uint32_t kGenerationMask = (1u << kGenerationBits) - 1;
+
+        /**
+         * @brief 从打包后的值构造
+         */
+        static SlotHandle FromPacked(uint64_t packed)noexcept
+        {
+            return SlotHandle(static_cast<uint32_t>(packed & 0xFFFFFFFFu),
+                static_cast<uint32_t>(packed >> 32) & kGenerationMask);
+        }
+
+    public:
+        SlotHandle()noexcept = default;
+        SlotHandle(uint32_t index, uint32_t generation)noexcept
+            : m_uIndex(index), m_uGeneration(generation & kGenerationMask) {}
+
+        operator bool()const noexcept { return m_uGeneration != 0; }
+
+        bool operator==(const SlotHandle& rhs)const noexcept
+        {
+            return m_uIndex == rhs.m_uIndex && m_uGeneration == rhs.m_uGeneration;
+        }
+
+        bool operator!=(const SlotHandle& rhs)const noexcept { return !(*this == rhs); }
+
+    public:
+        /**
+         * @brief 槽位下标
+         */
+        uint32_t GetIndex()const noexcept { return m_uIndex; }
+
+        /**
+         * @brief 代数
+         */
+        uint32_t GetGeneration()const noexcept { return m_uGeneration; }
+
+        /**
+         * @brief 打包为整数
+         */
+        uint64_t GetPacked()const noexcept
+        {
+            return (static_cast<uint64_t>(m_uGeneration) << 32) | m_uIndex;
+        }
+
+    private:
+        uint32_t m_uIndex = 0;
+        uint32_t m_uGeneration = 0;
+    };
+
+    /**
+     * @brief 槽位表
+     * @tparam T 值类型
+     *
+     * 值连续存放以便遍历，删除时将末尾元素移入空位。通过句柄访问的开销为两次数组下标运算。
+     * 插入或删除后，之前通过Get获得的指针失效，但句柄保持有效。
+     *
+     * 代数为奇数表示槽位被占用，为偶数表示空闲，因此默认构造的句柄总是无效的。
+     */
+    template <typename T>
+    class SlotMap
+    {
+        static const uint32_t kInvalidIndex = 0xFFFFFFFFu;
+
+        struct Slot
+        {
+            uint32_t Generation = 0;
+            uint32_t Index = 0;  // 占用时为值的下标，空闲时为下一个空闲槽位
+        };
+
+    public:
+        using ValueType = T;
+        using HandleType = SlotHandle;
+        using Iterator = typename std::vector<T>::iterator;
+        using ConstIterator = typename std::vector<T>::const_iterator;
+
+    public:
+        Iterator begin()noexcept { return m_stValues.begin(); }
+        Iterator end()noexcept { return m_stValues.end(); }
+        ConstIterator begin()const noexcept { return m_stValues.begin(); }
+        ConstIterator end()const noexcept { return m_stValues.end(); }
+
+    public:
+        /**
+         * @brief 元素个数
+         */
+        size_t GetSize()const noexcept { return m_stValues.size(); }
+
+        /**
+         * @brief 是否为空
+         */
+        bool IsEmpty()const noexcept { return m_stValues.empty(); }
+
+        /**
+         * @brief 预留空间
+         * @param count 元素个数
+         */
+        void Reserve(size_t count)
+        {
+            m_stSlots.reserve(count);
+            m_stValues.reserve(count);
+            m_stDenseToSlot.reserve(count);
+        }
+
+        /**
+         * @brief 构造新元素
+         * @return 句柄
+         */
+        template <typename... TArgs>
+        SlotHandle Emplace(TArgs&&... args)
+        {
+            if (m_uFreeHead == kInvalidIndex && m_stSlots.size() >= kInvalidIndex)
+                MOE_LUAWRP_THROW(std::length_error("SlotMap is full"));
+
+            // 提前扩容，保证末尾的push_back不会失败；按倍数增长以保持均摊O(1)
+            if (m_stDenseToSlot.size() == m_stDenseToSlot.capacity())
+                m_stDenseToSlot.reserve(std::max<size_t>(8, m_stDenseToSlot.capacity() * 2));
+            m_stValues.emplace_back(std::forward<TArgs>(args)...);
+
+            uint32_t index = m_uFreeHead;
+            if (index != kInvalidIndex)
+            {
+                m_uFreeHead = m_stSlots[index].Index;
+            }
+            else
+            {
+                MOE_LUAWRP_TRY
+                {
+                    m_stSlots.emplace_back();
+                }
+                MOE_LUAWRP_CATCH_ALL
+                {
+                    m_stValues.pop_back();
+                    MOE_LUAWRP_RETHROW;
+                }
+                index = static_cast<uint32_t>(m_stSlots.size() - 1);
+            }
+
+            auto& slot = m_stSlots[index];
+            slot.Generation = (slot.Generation + 1) & SlotHandle::kGenerationMask;
+            slot.Index = static_cast<uint32_t>(m_stValues.size() - 1);
+            m_stDenseToSlot.push_back(index);
+            return SlotHandle(index, slot.Generation);
+        }
+
+        /**
+         * @brief 删除元素
+         * @param h 句柄
+         * @return 句柄无效时返回false
+         */
+        bool Remove(SlotHandle h)
+        {
+            if (!IsValid(h))
+                return false;
+
+            auto& slot = m_stSlots[h.GetIndex()];
+            auto dense = slot.Index;
+            auto last = static_cast<uint32_t>(m_stValues.size() - 1);
+            if (dense != last)
+            {
+                m_stValues[dense] = std::move(m_stValues[last]);
+                m_stDenseToSlot[dense] = m_stDenseToSlot[last];
+                m_stSlots[m_stDenseToSlot[dense]].Index = dense;
+            }
+            m_stValues.pop_back();
+            m_stDenseToSlot.pop_back();
+
+            slot.Generation = (slot.Generation + 1) & SlotHandle::kGenerationMask;
+            slot.Index = m_uFreeHead;
+            m_uFreeHead = h.GetIndex();
+            return true;
+        }
+
+        /**
+         * @brief 清空
+         *
+         * 所有已发出的句柄都会失效。
+         */
+        void Clear()
+        {
+            while (!m_stDenseToSlot.empty())
+            {
+                auto index = m_stDenseToSlot.back();
+                Remove(SlotHandle(index, m_stSlots[index].Generation));
+            }
+        }
+
+        /**
+         * @brief 句柄是否有效
+         */
+        bool IsValid(SlotHandle h)const noexcept
+        {
+            return h.GetIndex() < m_stSlots.size() && (h.GetGeneration() & 1u) != 0 &&
+                m_stSlots[h.GetIndex()].Generation == h.GetGeneration();
+        }
+
+        /**
+         * @brief 通过句柄获取元素
+         * @return 句柄无效时返回nullptr
+         */
+        T* Get(SlotHandle h)noexcept
+        {
+            return IsValid(h) ? &m_stValues[m_stSlots[h.GetIndex()].Index] : nullptr;
+        }
+
+        const T* Get(SlotHandle h)const noexcept
+        {
+            return IsValid(h) ? &m_stValues[m_stSlots[h.GetIndex()].Index] : nullptr;
+        }
+
+        /**
+         * @brief 获取第i个连续存放的元素对应的句柄
+         * @param i 下标，与begin()开始的遍历顺序一致
+         */
+        SlotHandle GetHandleAt(size_t i)const noexcept
+        {
+            assert(i < m_stDenseToSlot.size());
+            auto index = m_stDenseToSlot[i];
+            return SlotHandle(index, m_stSlots[index].Generation);
+        }
+
+    private:
+        std::vector<Slot> m_stSlots;
+        std::vector<T> m_stValues;
+        std::vector<uint32_t> m_stDenseToSlot;
+        uint32_t m_uFreeHead = kInvalidIndex;
+    };
+
+    template <typename T>
+    const uint32_t SlotMap<T>::kInvalidIndex;
+
+    inline int Stack::Push(const SlotHandle& v)
+    {
+        lua_pushnumber(L, static_cast<lua_Number>(v.GetPacked()));
+        return 1;
+    }
+
+    template <typename T>
+    typename std::enable_if<details::IsSlotHandleType<T>::value, SlotHandle>::type Stack::Read(int idx)
+    {
+        auto v = luaL_checknumber(L, idx);
+        auto packed = static_cast<uint64_t>(v);
+        if (v < 0 || static_cast<lua_Number>(packed) != v || (packed >> (32 + SlotHandle::kGenerationBits)) != 0)
+            luaL_argerror(L, idx, "invalid handle");
+        return SlotHandle::FromPacked(packed);
+    }
+
+    namespace details
+    {
+        /**
+         * @brief 解析句柄
+         *
+         * 句柄无效时抛出Lua错误。
+         */
+        template <typename TStorage>
+        typename TStorage::ValueType& ResolveHandle(Stack& st, TStorage& storage, typename TStorage::HandleType h)
+        {
+            auto p = storage.Get(h);
+            if (!p)
+                luaL_argerror(st, 1, "invalid or stale handle");
+            return *p;
+        }
+
+        // --- HandleMethod ---
+
+        template <typename TStorage, typename TFunc>
+        struct HandleMethod;
+
+        template <typename TStorage, typename T, typename TRet, typename... TArgs>
+        struct HandleMethod<TStorage, TRet(T::*)(TArgs...)>
+        {
+            TStorage* Storage;
+            TRet(T::*Func)(TArgs...);
+
+            TRet operator()(Stack& st, typename TStorage::HandleType h, TArgs... args)
+            {
+                return (ResolveHandle(st, *Storage, h).*Func)(std::forward<TArgs>(args)...);
+            }
+        };
+
+        template <typename TStorage, typename T, typename TRet, typename... TArgs>
+        struct HandleMethod<TStorage, TRet(T::*)(TArgs...)const>
+        {
+            TStorage* Storage;
+            TRet(T::*Func)(TArgs...)const;
+
+            TRet operator()(Stack& st, typename TStorage::HandleType h, TArgs... args)
+            {
+                return (ResolveHandle(st, *Storage, h).*Func)(std::forward<TArgs>(args)...);
+            }
+        };
+
+        template <typename TStorage, typename T, typename TRet, typename... TArgs>
+        struct HandleMethod<TStorage, TRet(T::*)(Stack&, TArgs...)>
+        {
+            TStorage* Storage;
+            TRet(T::*Func)(Stack&, TArgs...);
+
+            TRet operator()(Stack& st, typename TStorage::HandleType h, TArgs... args)
+            {
+                return (ResolveHandle(st, *Storage, h).*Func)(st, std::forward<TArgs>(args)...);
+            }
+        };
+
+        template <typename TStorage, typename T, typename TRet, typename... TArgs>
+        struct HandleMethod<TStorage, TRet(T::*)(Stack&, TArgs...)const>
+        {
+            TStorage* Storage;
+            TRet(T::*Func)(Stack&, TArgs...)const;
+
+            TRet operator()(Stack& st, typename TStorage::HandleType h, TArgs... args)
+            {
+                return (ResolveHandle(st, *Storage, h).*Func)(st, std::forward<TArgs>(args)...);
+            }
+        };
+
+        // --- HandleProperty ---
+
+        template <typename TStorage, typename TReader, typename TWriter>
+        struct HandleProperty;
+
+        template <typename TStorage, typename TReader>
+        struct HandleProperty<TStorage, TReader, void>
+        {
+            using ReadType = decltype((std::declval<typename TStorage::ValueType&>().*std::declval<TReader>())());
+
+            TStorage* Storage;
+            TReader Reader;
+
+            ReadType operator()(Stack& st, typename TStorage::HandleType h)
+            {
+                return (ResolveHandle(st, *Storage, h).*Reader)();
+            }
+        };
+
+        template <typename TStorage, typename TReader, typename T, typename TValue>
+        struct HandleProperty<TStorage, TReader, void(T::*)(TValue)>
+        {
+            using ReadType = typename std::decay<decltype((std::declval<typename TStorage::ValueType&>().*
+                std::declval<TReader>())())>::type;
+
+            TStorage* Storage;
+            TReader Reader;
+            void(T::*Writer)(TValue);
+
+            Optional<ReadType> operator()(Stack& st, typename TStorage::HandleType h, VarArgs args)
+            {
+                auto& obj = ResolveHandle(st, *Storage, h);
+                if (args.IsEmpty())
+                    return Optional<ReadType>((obj.*Reader)());
+                (obj.*Writer)(args.template Get<TValue>(0));
+                return Optional<ReadType>();
+            }
+        };
+
+        template <typename TStorage>
+        struct HandleValidator
+        {
+            TStorage* Storage;
+
+            bool operator()(typename TStorage::HandleType h)
+            {
+                return Storage->Get(h) != nullptr;
+            }
+        };
+    }
+}
+}
@@ -6,35 +6,392 @@
 #pragma once
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <cassert>
+#include <new>
+#include <chrono>
 #include <string>
+#include <tuple>
+#include <vector>
 #include <stdexcept>
 #include <functional>
 #include <type_traits>
 
 #include <lua.hpp>
 
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <optional>
+#include <string_view>
+#define MOE_LUAWRP_STD_OPTIONAL
+#define MOE_LUAWRP_STD_STRING_VIEW
+#endif
+
+// 无异常模式：可手动定义MOE_LUAWRP_NO_EXCEPTIONS，编译器关闭异常时自动开启
+#if !defined(MOE_LUAWRP_NO_EXCEPTIONS) && !defined(__cpp_exceptions) && !defined(__EXCEPTIONS) && !defined(_CPPUNWIND)
+#define MOE_LUAWRP_NO_EXCEPTIONS
+#endif
+
+#ifdef MOE_LUAWRP_NO_EXCEPTIONS
+#define MOE_LUAWRP_TRY
+#define MOE_LUAWRP_CATCH(st)
+#define MOE_LUAWRP_CATCH_ALL if (false)
+#define MOE_LUAWRP_RETHROW ::abort()
+#define MOE_LUAWRP_THROW(ex) ::abort()
+#else
+#define MOE_LUAWRP_TRY try
+#define MOE_LUAWRP_CATCH(st) catch (const std::exception& ex) { (st).Error("%s", ex.what()); }
+#define MOE_LUAWRP_CATCH_ALL catch (...)
+#define MOE_LUAWRP_RETHROW throw
+#define MOE_LUAWRP_THROW(ex) throw ex
+#endif
+
+// Lua 5.3起整数是独立的子类型，64位整数可以不经过double直接读写
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 503 && defined(LUA_MAXINTEGER) && LUA_MAXINTEGER >= INT64_MAX
+#define MOE_LUAWRP_NATIVE_INT64
+#endif
+
 namespace moe
 {
 namespace LuaWrapper
 {
     class Reference;
+    class InternedKey;
+    class PinnedStringView;
+    class SlotHandle;
+    class Stack;
+
+    namespace details
+    {
+        template <typename T>
+        struct ReadResult;
+    }
 
+    template <typename T>
+    class Optional;
+
+    template <typename... T>
+    class Variant;
+
+    /**
+     * @brief 字符串视图
+     *
+     * 直接指向Lua字符串的内存，仅在对应的值留在栈上时有效。需要更长的生命周期时使用PinnedStringView。
+     */
     struct StringView
     {
         const char* Buffer = nullptr;
         size_t Length = 0;
+
+        StringView()noexcept = default;
+        StringView(const char* buffer, size_t length)noexcept
+            : Buffer(buffer), Length(length) {}
+
+        /**
+         * @brief 比较
+         * @return 小于0、等于0、大于0分别表示小于、等于、大于rhs
+         */
+        int Compare(const StringView& rhs)const noexcept
+        {
+            auto len = Length < rhs.Length ? Length : rhs.Length;
+            auto ret = len == 0 ? 0 : ::memcmp(Buffer, rhs.Buffer, len);
+            if (ret != 0)
+                return ret;
+            return Length < rhs.Length ? -1 : (Length > rhs.Length ? 1 : 0);
+        }
+
+        /**
+         * @brief 拷贝为std::string
+         */
+        std::string ToString()const
+        {
+            return std::string(Buffer, Length);
+        }
+
+#ifdef MOE_LUAWRP_STD_STRING_VIEW
+        operator std::string_view()const noexcept
+        {
+            return std::string_view(Buffer, Length);
+        }
+#endif
     };
 
+    inline bool operator==(const StringView& lhs, const StringView& rhs)noexcept
+    {
+        return lhs.Length == rhs.Length && (lhs.Length == 0 || ::memcmp(lhs.Buffer, rhs.Buffer, lhs.Length) == 0);
+    }
+
+    inline bool operator!=(const StringView& lhs, const StringView& rhs)noexcept { return !(lhs == rhs); }
+    inline bool operator<(const StringView& lhs, const StringView& rhs)noexcept { return lhs.Compare(rhs) < 0; }
+    inline bool operator<=(const StringView& lhs, const StringView& rhs)noexcept { return lhs.Compare(rhs) <= 0; }
+    inline bool operator>(const StringView& lhs, const StringView& rhs)noexcept { return lhs.Compare(rhs) > 0; }
+    inline bool operator>=(const StringView& lhs, const StringView& rhs)noexcept { return lhs.Compare(rhs) >= 0; }
+
     struct StackReference
     {
         unsigned AbsIndex = 0;
     };
 
+    /**
+     * @brief 变长参数
+     *
+     * 只能作为绑定函数的最后一个参数，按下标惰性访问剩余的栈上参数，不会拷贝到容器中。
+     * 仅在被调用函数返回前有效。
+     */
+    class VarArgs
+    {
+    public:
+        VarArgs(lua_State* vm, int start)noexcept
+            : L(vm), m_iStart(start)
+        {
+            auto top = lua_gettop(vm);
+            m_uCount = top >= start ? static_cast<unsigned>(top - start + 1) : 0u;
+        }
+
+    public:
+        /**
+         * @brief 参数个数
+         */
+        unsigned GetCount()const noexcept { return m_uCount; }
+
+        /**
+         * @brief 是否没有参数
+         */
+        bool IsEmpty()const noexcept { return m_uCount == 0; }
+
+        /**
+         * @brief 获取第i个参数的Lua类型
+         * @param i 下标，从0开始
+         * @return 越界时返回LUA_TNONE
+         */
+        int TypeOf(unsigned i)const noexcept
+        {
+            return i < m_uCount ? lua_type(L, m_iStart + static_cast<int>(i)) : LUA_TNONE;
+        }
+
+        /**
+         * @brief 读取第i个参数
+         * @tparam T 类型
+         * @param i 下标，从0开始
+         * @return 与Stack::Read<T>相同
+         */
+        template <typename T>
+        typename details::ReadResult<T>::Type Get(unsigned i)const;
+
+        /**
+         * @brief 获取第i个参数的栈引用
+         * @param i 下标，从0开始
+         *
+         * 可以直接用于Push，无需读取到C++。
+         */
+        StackReference operator[](unsigned i)const noexcept
+        {
+            assert(i < m_uCount);
+            StackReference ret;
+            ret.AbsIndex = static_cast<unsigned>(m_iStart) + i;
+            return ret;
+        }
+
+    private:
+        lua_State* L = nullptr;
+        int m_iStart = 0;
+        unsigned m_uCount = 0;
+    };
+
+    /**
+     * @brief 脚本执行超出预算
+     */
+    class ScriptTimeout :
+        public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * @brief 执行超出预算时使用的错误码
+     */
+    static const int kErrorTimeout = 0x100;
+
+    /**
+     * @brief 错误信息
+     */
+    struct Unexpected
+    {
+        std::string Message;
+        int Code = LUA_ERRRUN;
+
+        Unexpected() = default;
+        Unexpected(std::string message, int code=LUA_ERRRUN)
+            : Message(std::move(message)), Code(code) {}
+    };
+
+    /**
+     * @brief 批量调用中单条记录的错误
+     */
+    struct BatchError
+    {
+        size_t Index = 0;
+        std::string Message;
+        int Code = LUA_ERRRUN;
+
+        BatchError() = default;
+        BatchError(size_t index, std::string message, int code=LUA_ERRRUN)
+            : Index(index), Message(std::move(message)), Code(code) {}
+    };
+
+    /**
+     * @brief 值或错误
+     * @tparam T 值类型
+     *
+     * 绑定函数可以返回Expected<T>，出错时包装器会将错误信息作为Lua错误抛出，无需C++异常。
+     */
+    template <typename T>
+    class Expected
+    {
+    public:
+        using ValueType = T;
+
+    public:
+        Expected(const T& value)
+            : m_bHasValue(true)
+        {
+            new(&m_stStorage) T(value);
+        }
+
+        Expected(T&& value)
+            : m_bHasValue(true)
+        {
+            new(&m_stStorage) T(std::move(value));
+        }
+
+        Expected(Unexpected error)
+            : m_stError(std::move(error)) {}
+
+        Expected(const Expected& rhs)
+            : m_stError(rhs.m_stError), m_bHasValue(rhs.m_bHasValue)
+        {
+            if (m_bHasValue)
+                new(&m_stStorage) T(*rhs);
+        }
+
+        Expected(Expected&& rhs)
+            : m_stError(std::move(rhs.m_stError)), m_bHasValue(rhs.m_bHasValue)
+        {
+            if (m_bHasValue)
+                new(&m_stStorage) T(std::move(*rhs));
+        }
+
+        ~Expected()
+        {
+            if (m_bHasValue)
+                reinterpret_cast<T*>(&m_stStorage)->~T();
+        }
+
+        Expected& operator=(const Expected&) = delete;
+
+        operator bool()const noexcept { return m_bHasValue; }
+
+        T& operator*()noexcept
+        {
+            assert(m_bHasValue);
+            return *reinterpret_cast<T*>(&m_stStorage);
+        }
+
+        const T& operator*()const noexcept
+        {
+            assert(m_bHasValue);
+            return *reinterpret_cast<const T*>(&m_stStorage);
+        }
+
+        T* operator->()noexcept { return &**this; }
+        const T* operator->()const noexcept { return &**this; }
+
+    public:
+        /**
+         * @brief 是否持有值
+         */
+        bool HasValue()const noexcept { return m_bHasValue; }
+
+        /**
+         * @brief 获取错误信息
+         */
+        const Unexpected& GetError()const noexcept { return m_stError; }
+
+    private:
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type m_stStorage;
+        Unexpected m_stError;
+        bool m_bHasValue = false;
+    };
+
+    template <>
+    class Expected<void>
+    {
+    public:
+        using ValueType = void;
+
+    public:
+        Expected()noexcept
+            : m_bHasValue(true) {}
+
+        Expected(Unexpected error)
+            : m_stError(std::move(error)) {}
+
+        operator bool()const noexcept { return m_bHasValue; }
+
+    public:
+        bool HasValue()const noexcept { return m_bHasValue; }
+        const Unexpected& GetError()const noexcept { return m_stError; }
+
+    private:
+        Unexpected m_stError;
+        bool m_bHasValue = false;
+    };
+
+    /**
+     * @brief 可能失败的接口的返回类型
+     *
+     * 默认模式下失败时抛出异常，Result<T>即为T；无异常模式下为Expected<T>。
+     */
+#ifdef MOE_LUAWRP_NO_EXCEPTIONS
+    template <typename T>
+    using Result = Expected<T>;
+#else
+    template <typename T>
+    using Result = T;
+#endif
+
+    /**
+     * @brief 执行预算
+     *
+     * 指令数或时间为0时表示对应项不做限制。
+     */
+    struct ExecutionBudget
+    {
+        uint64_t MaxInstructions = 0;
+        uint64_t MaxMicroseconds = 0;
+
+        ExecutionBudget()noexcept = default;
+
+        ExecutionBudget(uint64_t maxInstructions, uint64_t maxMicroseconds=0)noexcept
+            : MaxInstructions(maxInstructions), MaxMicroseconds(maxMicroseconds)
+        {}
+
+        bool IsUnlimited()const noexcept
+        {
+            return MaxInstructions == 0 && MaxMicroseconds == 0;
+        }
+    };
+
     namespace details
     {
         template <typename T>
-        using IsStringViewType = typename std::is_same<typename std::decay<T>::type, StringView>;
+        using IsStringViewType = std::integral_constant<bool,
+            std::is_same<typename std::decay<T>::type, StringView>::value ||
+            std::is_same<typename std::decay<T>::type, PinnedStringView>::value
+#ifdef MOE_LUAWRP_STD_STRING_VIEW
+            || std::is_same<typename std::decay<T>::type, std::string_view>::value
+#endif
+        >;
 
         template <typename T>
         using IsStackReferenceType = typename std::is_same<typename std::decay<T>::type, StackReference>;
@@ -45,6 +402,47 @@ namespace LuaWrapper
         template <typename T>
         using IsReferenceType = typename std::is_same<typename std::decay<T>::type, Reference>;
 
+        template <typename T>
+        using IsVarArgsType = typename std::is_same<typename std::decay<T>::type, VarArgs>;
+
+        template <typename T>
+        using IsInternedKeyType = typename std::is_same<typename std::decay<T>::type, InternedKey>;
+
+        template <typename T>
+        using IsSlotHandleType = typename std::is_same<typename std::decay<T>::type, SlotHandle>;
+
+        /**
+         * @brief 没有直接提供重载的整数类型
+         *
+         * 例如signed char，以及LP64平台上与int64_t不是同一类型的long long（Lua 5.3起lua_Integer的默认类型）。
+         */
+        template <typename T>
+        struct IsExtraIntegerType
+        {
+            using DecayType = typename std::decay<T>::type;
+
+            static const bool value = std::is_integral<DecayType>::value && !std::is_same<DecayType, bool>::value &&
+                !std::is_same<DecayType, char>::value && !std::is_same<DecayType, uint8_t>::value &&
+                !std::is_same<DecayType, int16_t>::value && !std::is_same<DecayType, uint16_t>::value &&
+                !std::is_same<DecayType, int32_t>::value && !std::is_same<DecayType, uint32_t>::value &&
+                !std::is_same<DecayType, int64_t>::value && !std::is_same<DecayType, uint64_t>::value;
+        };
+
+        /**
+         * @brief 读写时使用的定长整数类型
+         */
+        template <typename T>
+        struct FixedIntegerType
+        {
+            using DecayType = typename std::decay<T>::type;
+
+            using Type = typename std::conditional<std::is_signed<DecayType>::value,
+                typename std::conditional<sizeof(DecayType) <= 2, int16_t,
+                    typename std::conditional<sizeof(DecayType) <= 4, int32_t, int64_t>::type>::type,
+                typename std::conditional<sizeof(DecayType) <= 2, uint16_t,
+                    typename std::conditional<sizeof(DecayType) <= 4, uint32_t, uint64_t>::type>::type>::type;
+        };
+
         template <typename T>
         struct IsStdPairTypeMatcher :
             public std::false_type
@@ -60,45 +458,530 @@ namespace LuaWrapper
         template <typename T>
         using IsStdPairType = IsStdPairTypeMatcher<typename std::decay<T>::type>;
 
+        template <typename T>
+        struct IsStdTupleTypeMatcher :
+            public std::false_type
+        {
+        };
+
+        template <typename... T>
+        struct IsStdTupleTypeMatcher<std::tuple<T...>> :
+            public std::true_type
+        {
+        };
+
+        template <typename T>
+        using IsStdTupleType = IsStdTupleTypeMatcher<typename std::decay<T>::type>;
+
+        template <typename T>
+        struct IsOptionalTypeMatcher :
+            public std::false_type
+        {
+        };
+
+        template <typename T>
+        struct IsOptionalTypeMatcher<Optional<T>> :
+            public std::true_type
+        {
+        };
+
+#ifdef MOE_LUAWRP_STD_OPTIONAL
+        template <typename T>
+        struct IsOptionalTypeMatcher<std::optional<T>> :
+            public std::true_type
+        {
+        };
+#endif
+
+        template <typename T>
+        using IsOptionalType = IsOptionalTypeMatcher<typename std::decay<T>::type>;
+
+        template <typename T>
+        struct IsVariantTypeMatcher :
+            public std::false_type
+        {
+        };
+
+        template <typename... T>
+        struct IsVariantTypeMatcher<Variant<T...>> :
+            public std::true_type
+        {
+        };
+
+        template <typename T>
+        using IsVariantType = IsVariantTypeMatcher<typename std::decay<T>::type>;
+
+        template <typename T>
+        struct IsExpectedTypeMatcher :
+            public std::false_type
+        {
+        };
+
+        template <typename T>
+        struct IsExpectedTypeMatcher<Expected<T>> :
+            public std::true_type
+        {
+        };
+
+        template <typename T>
+        using IsExpectedType = IsExpectedTypeMatcher<typename std::decay<T>::type>;
+
+        /**
+         * @brief 构造错误结果
+         *
+         * 默认模式下抛出异常（超出预算时为ScriptTimeout），无异常模式下返回错误。
+         */
+        template <typename T>
+        Result<T> MakeError(std::string message, int code=LUA_ERRRUN)
+        {
+#ifdef MOE_LUAWRP_NO_EXCEPTIONS
+            return Unexpected(std::move(message), code);
+#else
+            if (code == kErrorTimeout)
+                throw ScriptTimeout(message);
+            throw std::runtime_error(std::move(message));
+#endif
+        }
+
+        template <typename T>
+        struct IsStdFunctionTypeMatcher :
+            public std::false_type
+        {
+        };
+
+        template <typename TRet, typename... TArgs>
+        struct IsStdFunctionTypeMatcher<std::function<TRet(TArgs...)>> :
+            public std::true_type
+        {
+        };
+
+        /**
+         * @brief 显式要求绑定为Lua函数的函数对象
+         *
+         * 由Callable()构造。
+         */
+        template <typename F>
+        class CallableWrapper
+        {
+        public:
+            explicit CallableWrapper(F func)
+                : Func(std::move(func)) {}
+
+        public:
+            F Func;
+        };
+
+        template <typename T>
+        struct IsCallableWrapperTypeMatcher :
+            public std::false_type
+        {
+        };
+
+        template <typename F>
+        struct IsCallableWrapperTypeMatcher<CallableWrapper<F>> :
+            public std::true_type
+        {
+        };
+
+        template <typename T>
+        using IsCallableWrapperType = IsCallableWrapperTypeMatcher<typename std::decay<T>::type>;
+
+        struct HasStaticMethodRegisterValidator
+        {
+            template <class T,
+                typename = typename std::decay<decltype(T::Register)>::type>
+            static std::true_type Test(int);
+
+            template <typename>
+            static std::false_type Test(...);
+        };
+
+        template <typename T>
+        struct HasStaticMethodRegister :
+            public decltype(HasStaticMethodRegisterValidator::template Test<T>(0))
+        {};
+
+        struct HasCallOperatorValidator
+        {
+            template <class T,
+                typename = decltype(&T::operator())>
+            static std::true_type Test(int);
+
+            template <typename>
+            static std::false_type Test(...);
+        };
+
+        /**
+         * @brief 是否为可绑定为Lua函数的函数对象（lambda等）
+         *
+         * 要求operator()无重载，std::function与带有静态Register方法的用户类型除外。
+         * 仅用于RegisterMethod等显式注册函数的场合，Push需要通过Callable()显式指定。
+         */
+        template <typename T>
+        struct IsFunctorType
+        {
+            using DecayType = typename std::decay<T>::type;
+
+            static const bool value = std::is_class<DecayType>::value && !IsStdFunctionTypeMatcher<DecayType>::value &&
+                decltype(HasCallOperatorValidator::template Test<DecayType>(0))::value &&
+                !HasStaticMethodRegister<DecayType>::value;
+        };
+
         template <typename T>
         struct IsOtherType
         {
             static const bool value = !details::IsStringViewType<T>::value && !details::IsStackReferenceType<T>::value &&
-                !details::IsStdStringType<T>::value && !details::IsReferenceType<T>::value && !details::IsStdPairType<T>::value;
+                !details::IsStdStringType<T>::value && !details::IsReferenceType<T>::value && !details::IsStdPairType<T>::value &&
+                !details::IsStdTupleType<T>::value && !details::IsVarArgsType<T>::value && !details::IsOptionalType<T>::value &&
+                !details::IsVariantType<T>::value && !details::IsExpectedType<T>::value && !details::IsInternedKeyType<T>::value &&
+                !details::IsSlotHandleType<T>::value && !details::IsExtraIntegerType<T>::value &&
+                !details::IsCallableWrapperType<T>::value;
         };
 
         template <typename T>
         struct TypeRegisterHelper;
 
-        template <typename T>
-        struct Object;
+        template <typename T>
+        struct Object;
+
+        inline int TracebackImpl(lua_State *L)
+        {
+            int arg = 0;
+            lua_State* L1 = nullptr;
+
+            if (lua_isthread(L, 1))
+            {
+                arg = 1;
+                L1 = lua_tothread(L, 1);
+            }
+            else
+            {
+                arg = 0;
+                L1 = L;
+            }
+
+            const char* msg = lua_tostring(L, arg + 1);
+            if (msg == nullptr && !lua_isnoneornil(L, arg + 1))
+                lua_pushstring(L, "(Non-string error message)");
+            else
+            {
+                int level = (int)luaL_optinteger(L, arg + 2, (L == L1) ? 1 : 0);
+                luaL_traceback(L, L1, msg, level);
+            }
+            return 1;
+        }
+
+        // --- BudgetHook ---
+
+        /**
+         * @brief 预算检查周期（指令数）
+         */
+        static const int kBudgetCheckPeriod = 1000;
+
+        /**
+         * @brief 预算钩子的事件掩码
+         *
+         * Lua 5.x的钩子以线程为单位，需要借助调用事件为被恢复的协程安装钩子。LuaJIT的钩子是全局的，只需计数事件。
+         */
+#ifdef LUAJIT_VERSION_NUM
+        static const int kBudgetHookMask = LUA_MASKCOUNT;
+#else
+        static const int kBudgetHookMask = LUA_MASKCOUNT | LUA_MASKCALL;
+#endif
+
+        /**
+         * @brief 作用域内安装了钩子的协程
+         */
+        struct BudgetHookedThread
+        {
+            lua_State* Thread = nullptr;
+            lua_Hook PrevHook = nullptr;
+            int PrevMask = 0;
+            int PrevCount = 0;
+        };
+
+        struct BudgetHookContext
+        {
+            ExecutionBudget Budget;
+            uint64_t Executed = 0;
+            int Period = 0;
+            std::chrono::steady_clock::time_point Deadline;
+            bool Exceeded = false;
+            lua_State* YieldThread = nullptr;
+            int ThreadsRef = LUA_NOREF;
+            std::vector<BudgetHookedThread> Threads;
+        };
+
+        inline bool IsYieldable(lua_State* L)noexcept
+        {
+#if (defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 503) || (defined(LUAJIT_VERSION_NUM) && LUAJIT_VERSION_NUM >= 20100)
+            return lua_isyieldable(L) != 0;
+#else
+            // 无法直接判断时，检查调用链上是否存在C函数
+            lua_Debug ar;
+            for (int level = 0; lua_getstack(L, level, &ar); ++level)
+            {
+                lua_getinfo(L, "S", &ar);
+                if (ar.what && ar.what[0] == 'C')
+                    return false;
+            }
+            return true;
+#endif
+        }
+
+        inline void* BudgetHookKey()noexcept
+        {
+            static char s_cKey;
+            return &s_cKey;
+        }
+
+        inline void BudgetHookImpl(lua_State* L, lua_Debug* ar);
+
+#ifndef LUAJIT_VERSION_NUM
+        /**
+         * @brief 为即将被恢复的协程安装预算钩子
+         *
+         * 协程作为coroutine.resume的第一个参数，或作为coroutine.wrap返回的函数的第一个上值出现。
+         * 在作用域结束时恢复这些协程原来的钩子。
+         */
+        inline void HookResumedThread(lua_State* L, lua_Debug* ar, BudgetHookContext* ctx)
+        {
+            if (!lua_getinfo(L, "f", ar))  // f
+                return;
+            if (!lua_iscfunction(L, -1))
+            {
+                lua_pop(L, 1);
+                return;
+            }
+
+            lua_State* co = nullptr;
+            if (lua_getupvalue(L, -1, 1))  // f u
+            {
+                co = lua_tothread(L, -1);
+                lua_pop(L, 1);  // f
+            }
+            if (!co && lua_getlocal(L, ar, 1))  // f a
+            {
+                co = lua_tothread(L, -1);
+                lua_pop(L, 1);  // f
+            }
+            lua_pop(L, 1);
+
+            if (!co || co == L || lua_gethook(co) == BudgetHookImpl)
+                return;
+
+            // 持有协程，防止作用域结束前被回收
+            if (ctx->ThreadsRef == LUA_NOREF)
+            {
+                lua_newtable(L);  // t
+                ctx->ThreadsRef = luaL_ref(L, LUA_REGISTRYINDEX);
+            }
+            lua_rawgeti(L, LUA_REGISTRYINDEX, ctx->ThreadsRef);  // t
+            lua_pushthread(co);  // co: th
+            lua_xmove(co, L, 1);  // t th
+            lua_rawseti(L, -2, static_cast<int>(ctx->Threads.size() + 1));  // t
+            lua_pop(L, 1);
+
+            BudgetHookedThread info;
+            info.Thread = co;
+            info.PrevHook = lua_gethook(co);
+            info.PrevMask = lua_gethookmask(co);
+            info.PrevCount = lua_gethookcount(co);
+            ctx->Threads.push_back(info);
+
+            lua_sethook(co, BudgetHookImpl, kBudgetHookMask, ctx->Exceeded ? 1 : ctx->Period);
+        }
+#endif
+
+        inline void BudgetHookImpl(lua_State* L, lua_Debug* ar)
+        {
+            lua_pushlightuserdata(L, BudgetHookKey());
+            lua_rawget(L, LUA_REGISTRYINDEX);
+            auto ctx = static_cast<BudgetHookContext*>(lua_touserdata(L, -1));
+            lua_pop(L, 1);
+
+            // 作用域已经结束，移除作用域内创建的协程继承的钩子
+            if (!ctx)
+            {
+                lua_sethook(L, nullptr, 0, 0);
+                return;
+            }
+
+#ifndef LUAJIT_VERSION_NUM
+            if (ar->event != LUA_HOOKCOUNT)
+            {
+                HookResumedThread(L, ar, ctx);
+                return;
+            }
+#else
+            static_cast<void>(ar);
+#endif
+
+            if (!ctx->Exceeded)
+            {
+                ctx->Executed += static_cast<uint64_t>(ctx->Period);
+
+                if (ctx->Budget.MaxInstructions != 0 && ctx->Executed >= ctx->Budget.MaxInstructions)
+                    ctx->Exceeded = true;
+                else if (ctx->Budget.MaxMicroseconds != 0 && std::chrono::steady_clock::now() >= ctx->Deadline)
+                    ctx->Exceeded = true;
+                else
+                {
+                    // 剩余指令数不足一个周期时收紧检查间隔
+                    if (ctx->Budget.MaxInstructions != 0)
+                    {
+                        auto remain = ctx->Budget.MaxInstructions - ctx->Executed;
+                        if (remain < static_cast<uint64_t>(ctx->Period))
+                        {
+                            ctx->Period = static_cast<int>(remain);
+                            lua_sethook(L, BudgetHookImpl, kBudgetHookMask, ctx->Period);
+                        }
+                    }
+                    return;
+                }
+
+                // 超出预算后每条指令都触发钩子，防止脚本通过pcall吞掉错误继续执行，或尽快在可让出的位置让出
+                ctx->Period = 1;
+                lua_sethook(L, BudgetHookImpl, kBudgetHookMask, 1);
+            }
+
+            // 抢占模式下仅在目标线程可让出时让出，否则等待执行离开不可让出的区域；
+            // 目标线程恢复的其他协程无法代为让出，令其出错使执行回到目标线程
+            if (ctx->YieldThread == L)
+            {
+                if (IsYieldable(L))
+                    lua_yield(L, 0);
+                return;
+            }
+
+            luaL_error(L, "script execution budget exceeded");
+        }
+
+        /**
+         * @brief 预算钩子作用域
+         *
+         * 在作用域内安装计数钩子，析构时恢复之前的钩子与预算上下文，允许嵌套使用。
+         * Lua 5.x下经由coroutine.resume或coroutine.wrap恢复的协程同样会被安装钩子；在C++中直接恢复的协程不在此列。
+         * LuaJIT下最外层作用域会清除已经编译的trace并关闭JIT引擎，使钩子不被绕过，离开时恢复进入前的引擎状态。
+         * 若指定yieldThread，则超出预算时令该线程让出而非抛出错误。
+         */
+        class BudgetHookScope
+        {
+        public:
+            BudgetHookScope(lua_State* L, const ExecutionBudget& budget, lua_State* yieldThread=nullptr)
+                : m_pState(L), m_pPrevHook(lua_gethook(L)), m_iPrevMask(lua_gethookmask(L)),
+                m_iPrevCount(lua_gethookcount(L))
+            {
+                m_stContext.Budget = budget;
+                m_stContext.YieldThread = yieldThread;
+                m_stContext.Period = kBudgetCheckPeriod;
+                if (budget.MaxInstructions != 0 && budget.MaxInstructions < static_cast<uint64_t>(kBudgetCheckPeriod))
+                    m_stContext.Period = static_cast<int>(budget.MaxInstructions);
+                if (budget.MaxMicroseconds != 0)
+                {
+                    m_stContext.Deadline = std::chrono::steady_clock::now() +
+                        std::chrono::microseconds(budget.MaxMicroseconds);
+                }
+
+                lua_pushlightuserdata(L, BudgetHookKey());
+                lua_rawget(L, LUA_REGISTRYINDEX);
+                m_pPrevContext = lua_touserdata(L, -1);
+                lua_pop(L, 1);
+
+#ifdef LUAJIT_VERSION_NUM
+                // 钩子不会在JIT编译后的代码中触发，关闭引擎只能阻止新的编译，因此还需要清除已有的trace
+                if (!m_pPrevContext)
+                {
+                    m_bPrevJitOn = IsJitEngineOn(L);
+                    if (m_bPrevJitOn)
+                        luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+                    luaJIT_setmode(L, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_FLUSH);
+                }
+#endif
+
+                SetContext(&m_stContext);
+                lua_sethook(L, BudgetHookImpl, kBudgetHookMask, m_stContext.Period);
+            }
 
-        inline int TracebackImpl(lua_State *L)
-        {
-            int arg = 0;
-            lua_State* L1 = nullptr;
+            BudgetHookScope(const BudgetHookScope&) = delete;
+            BudgetHookScope(BudgetHookScope&&) = delete;
 
-            if (lua_isthread(L, 1))
+            ~BudgetHookScope()
             {
-                arg = 1;
-                L1 = lua_tothread(L, 1);
+#ifdef LUAJIT_VERSION_NUM
+                if (!m_pPrevContext && m_bPrevJitOn)
+                    luaJIT_setmode(m_pState, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_ON);
+#endif
+                lua_sethook(m_pState, m_pPrevHook, m_iPrevMask, m_iPrevCount);
+                SetContext(m_pPrevContext);
+
+                for (const auto& i : m_stContext.Threads)
+                    lua_sethook(i.Thread, i.PrevHook, i.PrevMask, i.PrevCount);
+                if (m_stContext.ThreadsRef != LUA_NOREF)
+                    luaL_unref(m_pState, LUA_REGISTRYINDEX, m_stContext.ThreadsRef);
             }
-            else
+
+        public:
+            bool IsExceeded()const noexcept { return m_stContext.Exceeded; }
+
+        private:
+            void SetContext(void* ctx)
             {
-                arg = 0;
-                L1 = L;
+                lua_pushlightuserdata(m_pState, BudgetHookKey());
+                if (ctx)
+                    lua_pushlightuserdata(m_pState, ctx);
+                else
+                    lua_pushnil(m_pState);
+                lua_rawset(m_pState, LUA_REGISTRYINDEX);
             }
 
-            const char* msg = lua_tostring(L, arg + 1);
-            if (msg == nullptr && !lua_isnoneornil(L, arg + 1))
-                lua_pushstring(L, "(Non-string error message)");
-            else
+#ifdef LUAJIT_VERSION_NUM
+            // LuaJIT没有查询引擎状态的C API，借助jit.status()获取；未加载jit库时引擎不会启动
+            static bool IsJitEngineOn(lua_State* L)
             {
-                int level = (int)luaL_optinteger(L, arg + 2, (L == L1) ? 1 : 0);
-                luaL_traceback(L, L1, msg, level);
+                bool ret = false;
+                lua_getfield(L, LUA_REGISTRYINDEX, "_LOADED");  // l
+                if (lua_istable(L, -1))
+                {
+                    lua_getfield(L, -1, "jit");  // l j
+                    if (lua_istable(L, -1))
+                    {
+                        lua_getfield(L, -1, "status");  // l j f
+                        if (lua_isfunction(L, -1) && lua_pcall(L, 0, 1, 0) == 0)  // l j r
+                            ret = lua_toboolean(L, -1) != 0;
+                        lua_pop(L, 1);  // l j
+                    }
+                    lua_pop(L, 1);  // l
+                }
+                lua_pop(L, 1);
+                return ret;
             }
-            return 1;
-        }
+#endif
+
+        private:
+            lua_State* m_pState = nullptr;
+            BudgetHookContext m_stContext;
+            void* m_pPrevContext = nullptr;
+            lua_Hook m_pPrevHook = nullptr;
+            int m_iPrevMask = 0;
+            int m_iPrevCount = 0;
+#ifdef LUAJIT_VERSION_NUM
+            bool m_bPrevJitOn = false;
+#endif
+        };
+    }
+
+    /**
+     * @brief 将函数对象标记为需要绑定为Lua函数
+     * @param func 函数对象，operator()不能重载
+     * @return 可直接用于Stack::Push的包装
+     *
+     * 带有operator()的类型默认仍作为userdata推入，只有经过Callable()包装才会绑定为Lua函数。
+     */
+    template <typename F>
+    details::CallableWrapper<typename std::decay<F>::type> Callable(F&& func)
+    {
+        return details::CallableWrapper<typename std::decay<F>::type>(std::forward<F>(func));
     }
 
     /**
@@ -259,22 +1142,36 @@ namespace LuaWrapper
 
         int Push(int64_t v)
         {
+#ifdef MOE_LUAWRP_NATIVE_INT64
+            lua_pushinteger(L, static_cast<lua_Integer>(v));
+#else
             if (sizeof(lua_Integer) == 8)
                 lua_pushinteger(L, static_cast<lua_Integer>(v));
             else
                 lua_pushnumber(L, static_cast<lua_Number>(v));
+#endif
             return 1;
         }
 
         int Push(uint64_t v)
         {
+#ifdef MOE_LUAWRP_NATIVE_INT64
+            lua_pushinteger(L, static_cast<lua_Integer>(v));  // 按补码存放，与Lua 5.3的无符号整数约定一致
+#else
             if (sizeof(lua_Integer) == 8)
                 lua_pushinteger(L, static_cast<lua_Integer>(v));
             else
                 lua_pushnumber(L, static_cast<lua_Number>(v));
+#endif
             return 1;
         }
 
+        template <typename T>
+        typename std::enable_if<details::IsExtraIntegerType<T>::value, int>::type Push(T v)
+        {
+            return Push(static_cast<typename details::FixedIntegerType<T>::Type>(v));
+        }
+
         int Push(float v)
         {
             lua_pushnumber(L, v);
@@ -314,12 +1211,37 @@ namespace LuaWrapper
             return 1;
         }
 
+#ifdef MOE_LUAWRP_STD_STRING_VIEW
+        int Push(std::string_view v)
+        {
+            lua_pushlstring(L, v.data(), v.size());
+            return 1;
+        }
+#endif
+
+        /**
+         * @brief 推入被固定的字符串，不产生拷贝
+         */
+        int Push(const PinnedStringView& v);
+
         int Push(const StackReference& v)
         {
             lua_pushvalue(L, static_cast<int>(v.AbsIndex));
             return 1;
         }
 
+        /**
+         * @brief 推入预先驻留的字符串
+         */
+        int Push(const InternedKey& v);
+
+        /**
+         * @brief 推入句柄
+         *
+         * 句柄以数字形式推入，不会产生GC对象。
+         */
+        int Push(const SlotHandle& v);
+
         template <typename T1, typename T2>
         int Push(const std::pair<T1, T2>& v)
         {
@@ -328,6 +1250,31 @@ namespace LuaWrapper
             return 2;
         }
 
+        /**
+         * @brief 推入tuple中的所有元素
+         * @return 推入的值个数
+         */
+        template <typename... T>
+        int Push(const std::tuple<T...>& v)
+        {
+            return PushTupleImpl<0>(v);
+        }
+
+        /**
+         * @brief 原样推入所有变长参数
+         * @return 推入的值个数
+         */
+        int Push(const VarArgs& v)
+        {
+            if (v.IsEmpty())
+                return 0;
+
+            luaL_checkstack(L, static_cast<int>(v.GetCount()), "too many arguments");
+            for (unsigned i = 0; i < v.GetCount(); ++i)
+                Push(v[i]);
+            return static_cast<int>(v.GetCount());
+        }
+
         template <typename TRet, typename... TArgs>
         int Push(TRet(*v)(TArgs...));
 
@@ -340,12 +1287,51 @@ namespace LuaWrapper
         template <typename T>
         typename std::enable_if<details::IsReferenceType<T>::value, int>::type Push(const T& rhs);
 
+        /**
+         * @brief 推入可选值，为空时推入nil
+         */
+        template <typename T>
+        typename std::enable_if<details::IsOptionalType<T>::value, int>::type Push(const T& rhs);
+
+        /**
+         * @brief 推入Expected持有的值
+         *
+         * 持有错误时以错误信息抛出Lua错误，因此只应在绑定函数返回时使用。
+         */
+        template <typename T>
+        typename std::enable_if<details::IsExpectedType<T>::value, int>::type Push(const T& rhs)
+        {
+            if (!rhs)
+            {
+                const auto& message = rhs.GetError().Message;
+                lua_pushlstring(L, message.c_str(), message.size());
+                lua_error(L);
+                return 0;
+            }
+            return PushExpectedValue(rhs);
+        }
+
+        /**
+         * @brief 推入Variant当前持有的值，为空时推入nil
+         */
+        template <typename T>
+        typename std::enable_if<details::IsVariantType<T>::value, int>::type Push(const T& rhs);
+
         template <typename T>
         typename std::enable_if<details::IsOtherType<T>::value, int>::type Push(T&& rhs);
 
         template <typename TRet, typename... TArgs>
         int Push(std::function<TRet(TArgs...)>&& v);
 
+        /**
+         * @brief 推入一个函数对象
+         *
+         * 函数对象直接保存在userdata中，调用时无需经过std::function的类型擦除。
+         * 参见Callable()。
+         */
+        template <typename F>
+        int Push(details::CallableWrapper<F>&& f);
+
         /**
          * @brief 拷贝栈上的值
          * @param idx 索引
@@ -413,6 +1399,22 @@ namespace LuaWrapper
         template <typename T>
         typename std::enable_if<details::IsReferenceType<T>::value, Reference>::type Read(int idx=-1);
 
+        /**
+         * @brief 读取可选值
+         *
+         * 值为nil或不存在时返回空值，否则按T读取。
+         */
+        template <typename T>
+        typename std::enable_if<details::IsOptionalType<T>::value, typename std::decay<T>::type>::type Read(int idx=-1);
+
+        /**
+         * @brief 读取Variant
+         *
+         * 按声明顺序选择第一个与Lua类型相符的候选类型读取，均不符时抛出Lua错误。
+         */
+        template <typename T>
+        typename std::enable_if<details::IsVariantType<T>::value, typename std::decay<T>::type>::type Read(int idx=-1);
+
         template <typename T>
         typename std::enable_if<std::is_same<T, std::string>::value, std::string>::type Read(int idx=-1);
 
@@ -425,6 +1427,40 @@ namespace LuaWrapper
         template <typename T>
         typename std::enable_if<std::is_same<T, const StringView&>::value, StringView>::type Read(int idx=-1);
 
+        /**
+         * @brief 读取字符串并固定其生命周期
+         *
+         * 数字会先被转换为字符串。
+         */
+        template <typename T>
+        typename std::enable_if<std::is_same<typename std::decay<T>::type, PinnedStringView>::value, PinnedStringView>::type
+        Read(int idx=-1);
+
+        template <typename T>
+        typename std::enable_if<details::IsSlotHandleType<T>::value, SlotHandle>::type Read(int idx=-1);
+
+#ifdef MOE_LUAWRP_STD_STRING_VIEW
+        template <typename T>
+        typename std::enable_if<std::is_same<typename std::decay<T>::type, std::string_view>::value, std::string_view>::type
+        Read(int idx=-1)
+        {
+            size_t len = 0;
+            auto p = luaL_checklstring(L, idx, &len);
+            return std::string_view(p, len);
+        }
+#endif
+
+        /**
+         * @brief 以给定位置为起点读取变长参数
+         */
+        template <typename T>
+        typename std::enable_if<details::IsVarArgsType<T>::value, VarArgs>::type Read(int idx=-1)
+        {
+            if (idx < 0 && idx > LUA_REGISTRYINDEX)
+                idx = lua_gettop(L) + idx + 1;
+            return VarArgs(L, idx);
+        }
+
         /**
          * @brief 在栈上新建一个用户对象
          * @tparam T 类型
@@ -471,6 +1507,65 @@ namespace LuaWrapper
             lua_newtable(L);
         }
 
+        /**
+         * @brief 在栈顶创建一个userdata
+         * @param size 大小
+         * @return 内存地址
+         *
+         * [-0, +1]
+         *
+         * Lua 5.4的lua_newuserdata总是附带一个用户值，这里不附带，以节省每个对象的内存。
+         */
+        void* NewUserData(size_t size)
+        {
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 504
+            return lua_newuserdatauv(L, size, 0);
+#else
+            return lua_newuserdata(L, size);
+#endif
+        }
+
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 504
+        /**
+         * @brief 在栈顶创建一个带有用户值的userdata
+         * @param size 大小
+         * @param userValues 用户值个数
+         * @return 内存地址
+         *
+         * [-0, +1]
+         */
+        void* NewUserData(size_t size, unsigned userValues)
+        {
+            return lua_newuserdatauv(L, size, static_cast<int>(userValues));
+        }
+
+        /**
+         * @brief 获取userdata的第n个用户值
+         * @param idx userdata的索引
+         * @param n 用户值序号，从1开始
+         * @return 值的类型，不存在时推入nil并返回LUA_TNONE
+         *
+         * [-0, +1]
+         */
+        int GetUserValue(int idx, unsigned n)
+        {
+            return lua_getiuservalue(L, idx, static_cast<int>(n));
+        }
+
+        /**
+         * @brief 以栈顶的值设置userdata的第n个用户值
+         * @param idx userdata的索引
+         * @param n 用户值序号，从1开始
+         * @return 用户值不存在时返回false
+         *
+         * [-1, +0]
+         */
+        bool SetUserValue(int idx, unsigned n)
+        {
+            return lua_setiuservalue(L, idx, static_cast<int>(n)) != 0;
+        }
+#endif
+
         /**
          * @brief 跳过metatable进行取值
          * @param idx 索引
@@ -505,6 +1600,15 @@ namespace LuaWrapper
             lua_getfield(L, idx, field);
         }
 
+        /**
+         * @brief 使用预先驻留的key取值
+         * @param idx table索引
+         * @param field key
+         *
+         * [-0, +1]
+         */
+        void GetField(int idx, const InternedKey& field);
+
         /**
          * @brief 设置指定栈位置的table的元素
          * @param idx table索引
@@ -517,6 +1621,15 @@ namespace LuaWrapper
             lua_setfield(L, idx, field);
         }
 
+        /**
+         * @brief 使用预先驻留的key赋值
+         * @param idx table索引
+         * @param field key
+         *
+         * [-1, +0]
+         */
+        void SetField(int idx, const InternedKey& field);
+
         /**
          * @brief 获取一个全局值
          * @param field key
@@ -528,6 +1641,13 @@ namespace LuaWrapper
             lua_getglobal(L, field);
         }
 
+        /**
+         * @brief 使用预先驻留的key获取全局值
+         *
+         * [-0, +1]
+         */
+        void GetGlobal(const InternedKey& field);
+
         /**
          * @brief 设置一个全局值
          * @param field key
@@ -539,18 +1659,60 @@ namespace LuaWrapper
             lua_setglobal(L, field);
         }
 
-#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM < 502
         /**
-         * @brief 设置函数的执行上下文
-         * @param idx 函数或者Thread的索引
+         * @brief 使用预先驻留的key设置全局值
          *
          * [-1, +0]
          */
-        void SetFunctionEnvironment(int idx)
+        void SetGlobal(const InternedKey& field);
+
+        /**
+         * @brief 推入全局表
+         *
+         * [-0, +1]
+         */
+        void PushGlobalTable()
         {
-            lua_setfenv(L, idx);
+#ifdef LUA_GLOBALSINDEX
+            lua_pushvalue(L, LUA_GLOBALSINDEX);
+#else
+            lua_rawgeti(L, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+#endif
         }
+
+        /**
+         * @brief 设置函数的执行上下文
+         * @param idx 函数的索引，Lua 5.1下也可以是Thread
+         * @return 无法设置时返回false
+         *
+         * [-1, +0]
+         *
+         * Lua 5.2起没有函数环境，改为设置名为_ENV的上值，因此要求函数带有调试信息。
+         * _ENV上值可能被同一个chunk中创建的其他闭包共享，应在执行chunk之前设置。
+         */
+        bool SetFunctionEnvironment(int idx)
+        {
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM < 502
+            return lua_setfenv(L, idx) != 0;
+#else
+            idx = lua_absindex(L, idx);
+            for (int i = 1; ; ++i)
+            {
+                auto name = lua_getupvalue(L, idx, i);  // e ?
+                if (!name)
+                    break;
+                lua_pop(L, 1);  // e
+
+                if (::strcmp(name, "_ENV") == 0)
+                {
+                    lua_setupvalue(L, idx, i);
+                    return true;
+                }
+            }
+            lua_pop(L, 1);
+            return false;
 #endif
+        }
 
         /**
          * @brief 抛出一个错误
@@ -592,8 +1754,10 @@ namespace LuaWrapper
          * @brief 安全调用函数，并在错误时抛出C++异常
          * @param nargs 参数个数
          * @param nrets 返回值个数
+         *
+         * 无异常模式下返回错误而不抛出异常。
          */
-        void CallAndThrow(unsigned nargs, unsigned nrets)
+        Result<void> CallAndThrow(unsigned nargs, unsigned nrets)
         {
 #ifndef NDEBUG
             unsigned topCheck = GetTop();
@@ -605,7 +1769,8 @@ namespace LuaWrapper
             assert(where >= 1);
             lua_insert(L, where);  // ... c, func, arg1, arg2
 
-            if (0 != lua_pcall(L, nargs, nrets, where))  // ... c, ret1, ret2
+            int ret = lua_pcall(L, nargs, nrets, where);
+            if (0 != ret)  // ... c, ret1, ret2
             {
                 std::string errmsg = lua_tostring(L, -1);
                 lua_pop(L, 2);  // ...
@@ -614,7 +1779,7 @@ namespace LuaWrapper
                 assert(topCheck - (1 + nargs) == GetTop());
 #endif
 
-                throw std::runtime_error(std::move(errmsg));
+                return details::MakeError<void>(std::move(errmsg), ret);
             }
 
             lua_remove(L, where);  // ... ret1, ret2
@@ -622,8 +1787,78 @@ namespace LuaWrapper
 #ifndef NDEBUG
             assert(topCheck - (1 + nargs) + nrets == GetTop());
 #endif
+            return Result<void>();
+        }
+
+        /**
+         * @brief 在执行预算内安全调用函数，并在错误时抛出C++异常
+         * @param nargs 参数个数
+         * @param nrets 返回值个数
+         * @param budget 执行预算
+         *
+         * 超出预算时抛出ScriptTimeout异常（无异常模式下错误码为kErrorTimeout）。
+         * 预算不设限时等价于CallAndThrow(nargs, nrets)，不安装钩子。
+         */
+        Result<void> CallAndThrow(unsigned nargs, unsigned nrets, const ExecutionBudget& budget)
+        {
+            if (budget.IsUnlimited())
+                return CallAndThrow(nargs, nrets);
+
+            details::BudgetHookScope scope(L, budget);
+#ifdef MOE_LUAWRP_NO_EXCEPTIONS
+            auto ret = CallAndThrow(nargs, nrets);
+            if (!ret && scope.IsExceeded())
+                return Unexpected(ret.GetError().Message, kErrorTimeout);
+            if (!ret)
+                return ret;
+#else
+            try
+            {
+                CallAndThrow(nargs, nrets);
+            }
+            catch (const std::runtime_error& ex)
+            {
+                if (scope.IsExceeded())
+                    throw ScriptTimeout(ex.what());
+                throw;
+            }
+#endif
+
+            // 错误可能在协程中被coroutine.resume吞掉，调用正常返回时仍需检查预算
+            if (scope.IsExceeded())
+            {
+                lua_pop(L, static_cast<int>(nrets));
+                return details::MakeError<void>("script execution budget exceeded", kErrorTimeout);
+            }
+            return Result<void>();
         }
 
+        /**
+         * @brief 以多组参数批量安全调用同一个函数
+         * @param count 记录条数
+         * @param out 输出数组，接收每条记录的第一个返回值；传入nullptr时丢弃返回值
+         * @param errors 失败的记录会追加到此处
+         * @param columns 参数列，每一列为长度为count的数组
+         * @return 成功的记录条数
+         *
+         * [-1, +0]
+         *
+         * 错误处理函数只安装一次，各条记录复用同一段栈空间。单条记录出错或返回值类型不符时不会中断批处理，
+         * 对应的输出保持不变。
+         */
+        template <typename TOut, typename... TArgs>
+        size_t CallBatch(size_t count, TOut out, std::vector<BatchError>& errors, const TArgs*... columns);
+
+        /**
+         * @brief 以多组参数批量安全调用被引用的函数
+         * @param func 函数
+         *
+         * [-0, +0]
+         */
+        template <typename TOut, typename... TArgs>
+        size_t CallBatch(const Reference& func, size_t count, TOut out, std::vector<BatchError>& errors,
+            const TArgs*... columns);
+
         /**
          * @brief 加载缓冲区
          * @param content 内容
@@ -631,17 +1866,19 @@ namespace LuaWrapper
          *
          * [-0, +1]
          *
-         * 当加载失败时，抛出异常。
+         * 当加载失败时，抛出异常。无异常模式下返回错误，栈保持不变。
          */
-        void LoadBuffer(const std::string& content, const char* name="")
+        Result<void> LoadBuffer(const std::string& content, const char* name="")
         {
-            if (0 != luaL_loadbuffer(L, content.c_str(), content.size(), name))
+            int ret = luaL_loadbuffer(L, content.c_str(), content.size(), name);
+            if (0 != ret)
             {
                 std::string errmsg = lua_tostring(L, -1);
                 lua_pop(L, 1);
 
-                throw std::runtime_error(std::move(errmsg));
+                return details::MakeError<void>(std::move(errmsg), ret);
             }
+            return Result<void>();
         }
 
         /**
@@ -650,20 +1887,46 @@ namespace LuaWrapper
          *
          * [-0, +1]
          *
-         * 当编译失败时抛出异常。
+         * 当编译失败时抛出异常。无异常模式下返回错误，栈保持不变。
          */
-        void LoadString(const char* content)
+        Result<void> LoadString(const char* content)
         {
-            if (0 != luaL_loadstring(L, content))
+            int ret = luaL_loadstring(L, content);
+            if (0 != ret)
             {
                 std::string errmsg = lua_tostring(L, -1);
                 lua_pop(L, 1);
 
-                throw std::runtime_error(std::move(errmsg));
+                return details::MakeError<void>(std::move(errmsg), ret);
             }
+            return Result<void>();
         }
 
     private:
+        template <typename T>
+        int PushExpectedValue(const Expected<T>& v)
+        {
+            return Push(*v);
+        }
+
+        int PushExpectedValue(const Expected<void>&)
+        {
+            return 0;
+        }
+
+        template <size_t I, typename... T>
+        typename std::enable_if<I == sizeof...(T), int>::type PushTupleImpl(const std::tuple<T...>&)
+        {
+            return 0;
+        }
+
+        template <size_t I, typename... T>
+        typename std::enable_if<I < sizeof...(T), int>::type PushTupleImpl(const std::tuple<T...>& v)
+        {
+            int n = Push(std::get<I>(v));
+            return n + PushTupleImpl<I + 1>(v);
+        }
+
         void ReadImpl(nullptr_t& out, int idx)
         {
             out = nullptr_t {};
@@ -719,18 +1982,34 @@ namespace LuaWrapper
 
         void ReadImpl(int64_t& out, int idx)
         {
+#ifdef MOE_LUAWRP_NATIVE_INT64
+            out = static_cast<int64_t>(luaL_checkinteger(L, idx));
+#else
             if (sizeof(lua_Integer) == 8)
                 out = static_cast<int64_t>(luaL_checkinteger(L, idx));
             else
                 out = static_cast<int64_t>(luaL_checknumber(L, idx));
+#endif
         }
 
         void ReadImpl(uint64_t& out, int idx)
         {
+#ifdef MOE_LUAWRP_NATIVE_INT64
+            out = static_cast<uint64_t>(luaL_checkinteger(L, idx));
+#else
             if (sizeof(lua_Integer) == 8)
                 out = static_cast<uint64_t>(luaL_checkinteger(L, idx));
             else
                 out = static_cast<uint64_t>(luaL_checknumber(L, idx));
+#endif
+        }
+
+        template <typename T>
+        typename std::enable_if<details::IsExtraIntegerType<T>::value>::type ReadImpl(T& out, int idx)
+        {
+            typename details::FixedIntegerType<T>::Type v;
+            ReadImpl(v, idx);
+            out = static_cast<T>(v);
         }
 
         void ReadImpl(float& out, int idx)
@@ -797,6 +2076,25 @@ namespace LuaWrapper
         return ret;
     }
 
+    namespace details
+    {
+        /**
+         * @brief Stack::Read<T>的返回类型
+         */
+        template <typename T>
+        struct ReadResult
+        {
+            using Type = decltype(std::declval<Stack&>().template Read<T>(0));
+        };
+    }
+
+    template <typename T>
+    typename details::ReadResult<T>::Type VarArgs::Get(unsigned i)const
+    {
+        Stack st(L);
+        return st.Read<T>(m_iStart + static_cast<int>(i));
+    }
+
     /**
      * @brief 栈平衡器
      */
@@ -824,3 +2122,22 @@ namespace LuaWrapper
     };
 }
 }
+
+namespace std
+{
+    template <>
+    struct hash<moe::LuaWrapper::StringView>
+    {
+        size_t operator()(const moe::LuaWrapper::StringView& v)const noexcept
+        {
+            // FNV-1a
+            uint64_t h = 14695981039346656037ull;
+            for (size_t i = 0; i < v.Length; ++i)
+            {
+                h ^= static_cast<unsigned char>(v.Buffer[i]);
+                h *= 1099511628211ull;
+            }
+            return static_cast<size_t>(h);
+        }
+    };
+}
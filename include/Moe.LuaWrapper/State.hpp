@@ -7,6 +7,17 @@
 #include "Stack.hpp"
 #include "Details.hpp"
 #include "Reference.hpp"
+#include "InternedKey.hpp"
+#include "PinnedStringView.hpp"
+#include "Coroutine.hpp"
+#include "Optional.hpp"
+#include "Variant.hpp"
+#include "SlotMap.hpp"
+#include "Batch.hpp"
+#include "Event.hpp"
+#include "Ffi.hpp"
+#include "Trusted.hpp"
+#include "Sandbox.hpp"
 
 namespace moe
 {
@@ -30,12 +41,40 @@ namespace LuaWrapper
 
             const char* name = details::TypeHelper<T>::TypeName();
 
-            if (luaL_newmetatable(TypeRegister<T>::m_stStack, name))
+            // 优先使用缓存的元表，注册表中的类型名被删除（例如被Restore还原）时重新关联
+            if (details::PushCachedMetatable<T>(st))
             {
-                // 注册基本函数
-                details::GenericRegisterFuncs<T>::Register(st);
+                lua_pushvalue(st, -1);
+                lua_setfield(st, LUA_REGISTRYINDEX, name);
+            }
+            else
+            {
+                lua_pop(st, 1);
+                if (luaL_newmetatable(TypeRegister<T>::m_stStack, name))
+                {
+                    // 注册基本函数
+                    details::GenericRegisterFuncs<T>::Register(st);
+                }
+                details::SetCachedMetatable<T>(st, -1);
             }
             TypeRegister<T>::m_iIndex = TypeRegister<T>::m_stStack.GetTop();
+
+            // 类型此前被延迟注册时，先执行记录的注册函数
+            auto builder = details::GetLazyTypeBuilder<T>(st);
+            if (builder)
+            {
+                MOE_LUAWRP_TRY
+                {
+                    builder(*this);
+                }
+                MOE_LUAWRP_CATCH_ALL
+                {
+                    // 构造函数失败时析构函数不会执行，需要自行弹出元表
+                    TypeRegister<T>::m_stStack.Remove(TypeRegister<T>::m_iIndex);
+                    MOE_LUAWRP_RETHROW;
+                }
+                details::ClearLazyTypeBuilder<T>(st);
+            }
         }
 
         ~RegisterTypeWrapper()
@@ -97,7 +136,7 @@ namespace LuaWrapper
             else if (m_stStack.TypeOf(-1) != LUA_TTABLE)
             {
                 m_stStack.Pop(2);
-                throw std::runtime_error("loop or previous error loading module");
+                MOE_LUAWRP_THROW(std::runtime_error("loop or previous error loading module"));
             }
 
             m_stStack.Remove(-2);
@@ -150,6 +189,56 @@ namespace LuaWrapper
             return *this;
         }
 
+        template <typename F>
+        typename std::enable_if<details::IsFunctorType<F>::value, RegisterModuleWrapper&>::type
+        RegisterMethod(const char* name, F&& func)
+        {
+            m_stStack.Push(Callable(std::forward<F>(func)));
+            m_stStack.SetField(m_iIndex, name);
+            return *this;
+        }
+
+        /**
+         * @brief 注册自由函数，LuaJIT下优先以FFI函数指针的形式暴露
+         * @param name 名称
+         * @param f 函数
+         *
+         * 参数只含数值（bool除外）与const char*、返回值为void、浮点数或不超过32位的整数时，生成FFI函数指针，
+         * 在热点循环中调用时可以被JIT编译为直接的C调用。其余签名或FFI不可用时回退为普通的C闭包。
+         * 经由FFI调用时无法传递C++异常，也无法访问Stack，被调用的函数不应抛出异常。
+         *
+         * FFI的参数转换比C API包装更严格：数值参数不接受数字字符串（例如"12"），const char*参数不接受数值，
+         * 这些调用会产生错误而不是被自动转换；const char*参数传入nil时得到nullptr。
+         * 需要与RegisterMethod完全一致的转换规则时应使用RegisterMethod。
+         */
+        template <typename TRet, typename... TArgs>
+        RegisterModuleWrapper& RegisterFfiMethod(const char* name, TRet(*f)(TArgs...))
+        {
+#ifdef LUAJIT_VERSION_NUM
+            if (details::PushFfiFunction(m_stStack, f))
+            {
+                m_stStack.SetField(m_iIndex, name);
+                return *this;
+            }
+#endif
+            return RegisterMethod(name, f);
+        }
+
+        /**
+         * @brief 以同一名称注册多个重载
+         *
+         * 调用时按注册顺序选择第一个参数个数与参数类型均匹配的候选。
+         */
+        template <typename F1, typename F2, typename... TFuncs>
+        RegisterModuleWrapper& RegisterMethod(const char* name, F1&& f1, F2&& f2, TFuncs&&... funcs)
+        {
+            details::OverloadWrapper<typename std::decay<F1>::type, typename std::decay<F2>::type,
+                typename std::decay<TFuncs>::type...>::Push(m_stStack, std::forward<F1>(f1), std::forward<F2>(f2),
+                std::forward<TFuncs>(funcs)...);
+            m_stStack.SetField(m_iIndex, name);
+            return *this;
+        }
+
     protected:
         RegisterModuleWrapper(RegisterModuleWrapper&& rhs)noexcept
             : m_stStack(std::move(rhs.m_stStack)), m_iIndex(rhs.m_iIndex)
@@ -183,6 +272,167 @@ namespace LuaWrapper
         int m_iIndex = 0;
     };
 
+    namespace details
+    {
+        /**
+         * @brief 延迟模块的加载器，由require调用
+         */
+        template <typename TBuilder>
+        struct LazyModuleLoader
+        {
+            TBuilder Builder;
+
+            Reference operator()(Stack& st, const char* name)
+            {
+                // Lua 5.1的require会先在_LOADED中放置哨兵，需要先清除才能按普通方式注册
+                st.GetField(LUA_REGISTRYINDEX, "_LOADED");  // t
+                st.Push(nullptr);  // t nil
+                st.SetField(-2, name);  // t
+
+                {
+                    RegisterModuleWrapper wrapper(st, name);
+                    Builder(wrapper);
+                }
+
+                st.GetField(-1, name);  // t m
+                st.Remove(-2);  // m
+                return Reference::Capture(st);
+            }
+        };
+    }
+
+    /**
+     * @brief 句柄类型注册器
+     * @tparam TStorage 存储，需要提供ValueType、HandleType与Get(handle)，例如SlotMap<T>
+     *
+     * Lua侧仅持有句柄（数字），实体的生命周期完全由C++的存储管理，不产生任何GC对象。
+     * 由于数字没有独立的元表，方法注册在与类型同名的模块表中，以`Entity.Move(h, dx, dy)`的形式调用。
+     * 句柄失效时调用会引发Lua错误，可以通过模块中的IsValid(h)预先检查。
+     * 存储需要在State使用期间保持存活。
+     */
+    template <typename TStorage>
+    class RegisterHandleTypeWrapper :
+        public RegisterModuleWrapper
+    {
+        friend class State;
+
+        using ValueType = typename TStorage::ValueType;
+
+    public:
+        RegisterHandleTypeWrapper(Stack& st, const char* name, TStorage& storage)
+            : RegisterModuleWrapper(st, name), m_pStorage(&storage)
+        {
+            RegisterModuleWrapper::RegisterMethod("IsValid", details::HandleValidator<TStorage> { m_pStorage });
+        }
+
+    public:
+        /**
+         * @brief 注册方法
+         * @param name 方法名称
+         * @param f 成员函数，调用时通过第一个参数的句柄解析对象
+         */
+        template <typename TFunc>
+        typename std::enable_if<std::is_member_function_pointer<TFunc>::value, RegisterHandleTypeWrapper&>::type
+        RegisterMethod(const char* name, TFunc f)
+        {
+            RegisterModuleWrapper::RegisterMethod(name, details::HandleMethod<TStorage, TFunc> { m_pStorage, f });
+            return *this;
+        }
+
+        /**
+         * @brief 注册自由函数、原生函数或函数对象
+         *
+         * 不经过句柄解析，可用于自行管理数据布局（例如SoA）的存储。
+         */
+        template <typename F>
+        typename std::enable_if<!std::is_member_function_pointer<typename std::decay<F>::type>::value,
+            RegisterHandleTypeWrapper&>::type
+        RegisterMethod(const char* name, F&& func)
+        {
+            RegisterModuleWrapper::RegisterMethod(name, std::forward<F>(func));
+            return *this;
+        }
+
+        /**
+         * @brief 注册只读属性
+         * @param name 属性名称
+         * @param reader 读取方法
+         *
+         * 在Lua中以`Entity.name(h)`读取。
+         */
+        template <typename TValue, typename T>
+        RegisterHandleTypeWrapper& RegisterProperty(const char* name, TValue(T::*reader)())
+        {
+            RegisterModuleWrapper::RegisterMethod(name,
+                details::HandleProperty<TStorage, TValue(T::*)(), void> { m_pStorage, reader });
+            return *this;
+        }
+
+        template <typename TValue, typename T>
+        RegisterHandleTypeWrapper& RegisterProperty(const char* name, TValue(T::*reader)()const)
+        {
+            RegisterModuleWrapper::RegisterMethod(name,
+                details::HandleProperty<TStorage, TValue(T::*)()const, void> { m_pStorage, reader });
+            return *this;
+        }
+
+        /**
+         * @brief 注册读写属性
+         * @param name 属性名称
+         * @param reader 读取方法
+         * @param writer 赋值方法
+         *
+         * 在Lua中以`Entity.name(h)`读取，以`Entity.name(h, value)`赋值。
+         */
+        template <typename TValue, typename T, typename TValue2 = TValue>
+        RegisterHandleTypeWrapper& RegisterProperty(const char* name, TValue(T::*reader)(), void(T::*writer)(TValue2))
+        {
+            RegisterModuleWrapper::RegisterMethod(name,
+                details::HandleProperty<TStorage, TValue(T::*)(), void(T::*)(TValue2)> { m_pStorage, reader, writer });
+            return *this;
+        }
+
+        template <typename TValue, typename T, typename TValue2 = TValue>
+        RegisterHandleTypeWrapper& RegisterProperty(const char* name, TValue(T::*reader)()const,
+            void(T::*writer)(TValue2))
+        {
+            RegisterModuleWrapper::RegisterMethod(name,
+                details::HandleProperty<TStorage, TValue(T::*)()const, void(T::*)(TValue2)> { m_pStorage, reader, writer });
+            return *this;
+        }
+
+    protected:
+        RegisterHandleTypeWrapper(RegisterHandleTypeWrapper&& rhs)noexcept
+            : RegisterModuleWrapper(std::move(rhs)), m_pStorage(rhs.m_pStorage)
+        {}
+
+    private:
+        TStorage* m_pStorage = nullptr;
+    };
+
+    /**
+     * @brief GC统计信息
+     *
+     * 仅统计通过State::GcStep显式执行的增量回收。
+     */
+    struct GcStatistics
+    {
+        uint64_t StepCount = 0;
+        uint64_t CollectedBytes = 0;
+        uint64_t StepMicroseconds = 0;
+    };
+
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 504
+    /**
+     * @brief GC模式
+     */
+    enum class GcMode
+    {
+        Incremental,
+        Generational,
+    };
+#endif
+
     /**
      * @brief Lua状态封装
      */
@@ -194,7 +444,7 @@ namespace LuaWrapper
             : Stack(luaL_newstate())
         {
             if (!L)
-                throw std::runtime_error("luaL_newstate failed");
+                MOE_LUAWRP_THROW(std::runtime_error("luaL_newstate failed"));
 
 #ifndef LUA_RIDX_MAINTHREAD
 #ifndef NDEBUG
@@ -209,7 +459,7 @@ namespace LuaWrapper
         }
         State(const State&) = delete;
         State(State&& rhs)noexcept
-            : Stack(std::move(rhs))
+            : Stack(std::move(rhs)), m_stGcStatistics(rhs.m_stGcStatistics)
         {}
 
         ~State()noexcept
@@ -226,6 +476,7 @@ namespace LuaWrapper
         State& operator=(State&& rhs)noexcept
         {
             Stack::operator=(std::move(rhs));
+            m_stGcStatistics = rhs.m_stGcStatistics;
             return *this;
         }
 
@@ -251,6 +502,35 @@ namespace LuaWrapper
             return RegisterTypeWrapper<typename details::Object<T>::Type>(*this);
         }
 
+        /**
+         * @brief 延迟注册一个类型
+         * @tparam T 类型
+         * @param builder 注册函数，签名与侵入式注册的T::Register相同，可以使用不捕获变量的lambda
+         *
+         * 此时仅记录注册函数，直到首次创建该类型的对象或调用RegisterType<T>()时才构造元表及其中的方法。
+         * 带有静态Register方法的类型本身就在首次使用时注册，无需使用此方法。
+         */
+        template <typename T>
+        void RegisterLazyType(details::LazyTypeBuilder<typename details::Object<T>::Type> builder)
+        {
+            using RealType = typename details::Object<T>::Type;
+            static_assert(!details::TypeRegisterHelper<RealType>::CanAutoRegister,
+                "Type is registered automatically on first use");
+            assert(builder);
+
+            if (details::PushCachedMetatable<RealType>(L))
+            {
+                // 已经注册过，直接补充到现有的元表中
+                TypeRegister<RealType> reg(*this, GetTop());
+                builder(reg);
+                Pop(1);
+                return;
+            }
+            Pop(1);
+
+            details::SetLazyTypeBuilder<RealType>(*this, builder);
+        }
+
         /**
          * @brief 注册模块
          * @param name 模块名
@@ -260,6 +540,467 @@ namespace LuaWrapper
         {
             return RegisterModuleWrapper(*this, name);
         }
+
+        /**
+         * @brief 延迟注册模块
+         * @param name 模块名
+         * @param builder 形如void(RegisterModuleWrapper&)的函数对象，用于填充模块
+         *
+         * 在package.preload中安装加载器，首次require时才调用builder创建模块表以及其中的函数。
+         * 需要先加载package库。若同名模块已经注册，require不会调用加载器。
+         */
+        template <typename TBuilder>
+        void RegisterLazyModule(const char* name, TBuilder&& builder)
+        {
+#ifndef NDEBUG
+            unsigned topCheck = GetTop();
+#endif
+
+            GetField(LUA_REGISTRYINDEX, "_LOADED");  // t
+            if (TypeOf(-1) == LUA_TTABLE)
+                GetField(-1, "package");  // t p
+            else
+                Push(nullptr);  // ? nil
+            if (TypeOf(-1) != LUA_TTABLE)
+            {
+                Pop(2);
+                MOE_LUAWRP_THROW(std::runtime_error("package library is not loaded"));
+            }
+            GetField(-1, "preload");  // t p l
+            if (TypeOf(-1) != LUA_TTABLE)
+            {
+                Pop(3);
+                MOE_LUAWRP_THROW(std::runtime_error("package.preload must be a table"));
+            }
+
+            using LoaderType = details::LazyModuleLoader<typename std::decay<TBuilder>::type>;
+            Push(Callable(LoaderType { std::forward<TBuilder>(builder) }));  // t p l f
+            SetField(-2, name);  // t p l
+            Pop(3);
+
+#ifndef NDEBUG
+            assert(topCheck == GetTop());
+#endif
+        }
+
+        /**
+         * @brief 注册句柄类型
+         * @param name 模块名
+         * @param storage 存储
+         * @return 句柄类型注册器
+         *
+         * 适用于数量庞大、生命周期由C++管理的实体，Lua侧仅持有句柄。
+         */
+        template <typename TStorage>
+        RegisterHandleTypeWrapper<TStorage> RegisterHandleType(const char* name, TStorage& storage)
+        {
+            return RegisterHandleTypeWrapper<TStorage>(*this, name, storage);
+        }
+
+#ifdef LUAJIT_VERSION_NUM
+        /**
+         * @brief 注册LuaJIT FFI结构
+         * @tparam T 标准布局且可平凡复制的类型
+         * @param name C类型名
+         * @return FFI结构注册器，登记完字段与方法后调用Commit完成定义
+         *
+         * 与RegisterType互不影响，同一类型可以同时以userdata和cdata两种形式暴露。
+         */
+        template <typename T>
+        FfiTypeRegister<T> RegisterFfiType(const char* name)
+        {
+            return FfiTypeRegister<T>(*this, name);
+        }
+#endif
+
+    public:
+        /**
+         * @brief 停止自动GC
+         */
+        void GcStop()
+        {
+            lua_gc(L, LUA_GCSTOP, 0);
+        }
+
+        /**
+         * @brief 恢复自动GC
+         */
+        void GcRestart()
+        {
+            lua_gc(L, LUA_GCRESTART, 0);
+        }
+
+#ifdef LUA_GCISRUNNING
+        /**
+         * @brief 自动GC是否在运行
+         */
+        bool GcIsRunning()
+        {
+            return lua_gc(L, LUA_GCISRUNNING, 0) != 0;
+        }
+#endif
+
+#if defined(LUA_VERSION_NUM) && LUA_VERSION_NUM >= 504
+        /**
+         * @brief 切换为分代GC
+         * @param minorMultiplier 内存增长到上次主回收后的minorMultiplier%时执行次回收，0表示不修改
+         * @param majorMultiplier 内存增长到上次主回收后的majorMultiplier%时执行主回收，0表示不修改
+         * @return 切换前的模式
+         */
+        GcMode GcSetGenerational(int minorMultiplier=0, int majorMultiplier=0)
+        {
+            return lua_gc(L, LUA_GCGEN, minorMultiplier, majorMultiplier) == LUA_GCGEN ? GcMode::Generational :
+                GcMode::Incremental;
+        }
+
+        /**
+         * @brief 切换为增量GC
+         * @param pause 间歇率，0表示不修改
+         * @param stepMultiplier 步进倍率，0表示不修改
+         * @param stepSize 单步大小（以2为底的对数，单位为字节），0表示不修改
+         * @return 切换前的模式
+         */
+        GcMode GcSetIncremental(int pause=0, int stepMultiplier=0, int stepSize=0)
+        {
+            return lua_gc(L, LUA_GCINC, pause, stepMultiplier, stepSize) == LUA_GCGEN ? GcMode::Generational :
+                GcMode::Incremental;
+        }
+#endif
+
+        /**
+         * @brief 执行一次完整的GC
+         */
+        void GcCollect()
+        {
+            lua_gc(L, LUA_GCCOLLECT, 0);
+        }
+
+        /**
+         * @brief 设置GC间歇率
+         * @param percent 百分比，内存增长到上次回收后的percent%时开始新一轮回收
+         * @return 旧值
+         */
+        int GcSetPause(int percent)
+        {
+            return lua_gc(L, LUA_GCSETPAUSE, percent);
+        }
+
+        /**
+         * @brief 设置GC步进倍率
+         * @param percent 百分比，相对于内存分配速度的回收速度
+         * @return 旧值
+         */
+        int GcSetStepMultiplier(int percent)
+        {
+            return lua_gc(L, LUA_GCSETSTEPMUL, percent);
+        }
+
+        /**
+         * @brief 获取Lua使用的内存字节数
+         */
+        size_t GcGetMemoryUsage()
+        {
+            return static_cast<size_t>(lua_gc(L, LUA_GCCOUNT, 0)) * 1024u + static_cast<size_t>(lua_gc(L, LUA_GCCOUNTB, 0));
+        }
+
+        /**
+         * @brief 在给定的时间预算内执行增量GC
+         * @param budgetMicros 时间预算（微秒）
+         * @return 是否完成了一轮回收
+         *
+         * 逐个执行基本步，直到预算耗尽或一轮回收结束，适合在空闲时段调用。
+         * 步进粒度由Lua决定，实际耗时可能略微超出预算。分代模式下每一步都是一次完整的次回收。
+         */
+        bool GcStep(uint64_t budgetMicros)
+        {
+            using Clock = std::chrono::steady_clock;
+
+            auto start = Clock::now();
+            auto deadline = start + std::chrono::microseconds(budgetMicros);
+            bool finished = false;
+
+            auto before = GcGetMemoryUsage();
+            do
+            {
+                finished = (lua_gc(L, LUA_GCSTEP, 0) != 0);
+                ++m_stGcStatistics.StepCount;
+
+                auto after = GcGetMemoryUsage();
+                if (after < before)
+                    m_stGcStatistics.CollectedBytes += before - after;
+                before = after;
+            } while (!finished && Clock::now() < deadline);
+
+            m_stGcStatistics.StepMicroseconds += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+            return finished;
+        }
+
+        /**
+         * @brief 将当前的全局环境记录为基线
+         *
+         * 从全局表、注册表中的字符串键以及字符串的元表出发，记录所有可以到达的表（包括_LOADED中的模块表、
+         * package.preload、package.loaders/searchers以及这些表的元表）的浅拷贝与元表，
+         * 同时记录注册表中字符串键的浅拷贝，供Restore使用。再次调用会覆盖之前的基线。
+         * 注册表的整数键下保存的引用、元表缓存以及类型元表的名称由C++管理，需要在多次请求之间保留，不在记录范围内。
+         */
+        void Checkpoint()
+        {
+#ifndef NDEBUG
+            unsigned topCheck = GetTop();
+#endif
+
+            lua_newtable(L);  // c
+            int contents = lua_gettop(L);
+            lua_newtable(L);  // c m
+            int metatables = contents + 1;
+            lua_newtable(L);  // c m r
+            int registry = contents + 2;
+            lua_newtable(L);  // c m r p
+            int pending = contents + 3;
+            int count = 0;
+
+            PushGlobalTable();  // c m r p g
+            lua_rawseti(L, pending, ++count);  // c m r p
+
+            lua_pushnil(L);  // c m r p nil
+            while (lua_next(L, LUA_REGISTRYINDEX))  // c m r p k v
+            {
+                if (!IsCheckpointRegistryKey(-2))
+                {
+                    lua_pop(L, 1);  // c m r p k
+                    continue;
+                }
+
+                if (lua_type(L, -1) == LUA_TTABLE)
+                {
+                    lua_pushvalue(L, -1);  // c m r p k v v
+                    lua_rawseti(L, pending, ++count);  // c m r p k v
+                }
+                lua_pushvalue(L, -2);  // c m r p k v k
+                lua_insert(L, -2);  // c m r p k k v
+                lua_rawset(L, registry);  // c m r p k
+            }
+
+            PushStringMetatable();  // c m r p smt
+            if (lua_type(L, -1) == LUA_TTABLE)
+            {
+                lua_pushvalue(L, -1);  // c m r p smt smt
+                lua_rawseti(L, pending, ++count);  // c m r p smt
+            }
+            lua_insert(L, pending);  // c m r smt p
+
+            // 使用显式的待处理列表遍历，避免深层嵌套的表耗尽C栈
+            while (count > 0)
+            {
+                lua_rawgeti(L, -1, count);  // c m r smt p t
+                lua_pushnil(L);  // c m r smt p t nil
+                lua_rawseti(L, -3, count--);  // c m r smt p t
+                CheckpointTable(contents, metatables, count);  // c m r smt p
+            }
+            lua_pop(L, 1);  // c m r smt
+
+            lua_createtable(L, 4, 0);  // c m r smt s
+            lua_insert(L, contents);  // s c m r smt
+            lua_rawseti(L, contents, 4);  // s c m r
+            lua_rawseti(L, contents, 3);  // s c m
+            lua_rawseti(L, contents, 2);  // s c
+            lua_rawseti(L, contents, 1);  // s
+            SetField(LUA_REGISTRYINDEX, "__checkpoint");
+
+#ifndef NDEBUG
+            assert(topCheck == GetTop());
+#endif
+        }
+
+        /**
+         * @brief 将全局环境恢复到Checkpoint时的状态
+         * @return 未调用过Checkpoint时返回false
+         *
+         * 删除之后新增的键，还原被修改或删除的键以及元表。之后require的模块会从_LOADED中移除，下次require时重新加载。
+         * 耗时与记录的表的总大小成正比，而不是与修改的数量成正比。Checkpoint时无法到达的表（例如userdata的元表）不会被还原。
+         * 运行不可信的脚本时应配合Sandbox为每个请求提供独立的环境表，并且不要向脚本开放debug库。
+         */
+        bool Restore()
+        {
+#ifndef NDEBUG
+            unsigned topCheck = GetTop();
+#endif
+
+            GetField(LUA_REGISTRYINDEX, "__checkpoint");  // s
+            if (lua_type(L, -1) != LUA_TTABLE)
+            {
+                lua_pop(L, 1);
+                return false;
+            }
+
+            lua_rawgeti(L, -1, 1);  // s c
+            lua_rawgeti(L, -2, 2);  // s c m
+            int metatables = lua_gettop(L);
+            int contents = metatables - 1;
+
+            lua_pushnil(L);  // s c m nil
+            while (lua_next(L, contents))  // s c m t copy
+            {
+                RestoreTable(false);  // s c m t copy
+
+                lua_pushvalue(L, -2);  // s c m t copy t
+                lua_rawget(L, metatables);  // s c m t copy mt
+                if (!lua_toboolean(L, -1))
+                {
+                    lua_pop(L, 1);
+                    lua_pushnil(L);  // s c m t copy nil
+                }
+                lua_setmetatable(L, -3);  // s c m t copy
+                lua_pop(L, 1);  // s c m t
+            }
+            lua_pop(L, 2);  // s
+
+            lua_pushvalue(L, LUA_REGISTRYINDEX);  // s reg
+            lua_rawgeti(L, -2, 3);  // s reg r
+            RestoreTable(true);  // s reg r
+            lua_pop(L, 2);  // s
+
+            lua_pushliteral(L, "");  // s str
+            lua_rawgeti(L, -2, 4);  // s str smt
+            if (!lua_toboolean(L, -1))
+            {
+                lua_pop(L, 1);
+                lua_pushnil(L);  // s str nil
+            }
+            lua_setmetatable(L, -2);  // s str
+            lua_pop(L, 2);
+
+#ifndef NDEBUG
+            assert(topCheck == GetTop());
+#endif
+            return true;
+        }
+
+        /**
+         * @brief 获取GC统计信息
+         */
+        const GcStatistics& GetGcStatistics()const noexcept { return m_stGcStatistics; }
+
+        /**
+         * @brief 重置GC统计信息
+         */
+        void ResetGcStatistics()noexcept
+        {
+            m_stGcStatistics = GcStatistics();
+        }
+
+    private:
+        // 注册表中需要记录的键：字符串键，__checkpoint与类型元表的名称除外（与整数键下的元表缓存一同由C++管理）
+        bool IsCheckpointRegistryKey(int idx)
+        {
+            if (lua_type(L, idx) != LUA_TSTRING)
+                return false;
+            auto key = lua_tostring(L, idx);
+            return ::strcmp(key, "__checkpoint") != 0 && ::strncmp(key, "__type_", 7) != 0;
+        }
+
+        // [-0, +1]
+        void PushStringMetatable()
+        {
+            lua_pushliteral(L, "");  // str
+            if (!lua_getmetatable(L, -1))
+                lua_pushboolean(L, 0);  // str mt
+            lua_remove(L, -2);  // mt
+        }
+
+        // [-1, +0]
+        void CheckpointTable(int contents, int metatables, int& count)  // p t
+        {
+            lua_pushvalue(L, -1);  // p t t
+            lua_rawget(L, contents);  // p t ?
+            if (!lua_isnil(L, -1))
+            {
+                lua_pop(L, 2);
+                return;
+            }
+            lua_pop(L, 1);  // p t
+
+            lua_newtable(L);  // p t copy
+            lua_pushnil(L);  // p t copy nil
+            while (lua_next(L, -3))  // p t copy k v
+            {
+                if (lua_type(L, -1) == LUA_TTABLE)
+                {
+                    lua_pushvalue(L, -1);  // p t copy k v v
+                    lua_rawseti(L, -6, ++count);  // p t copy k v
+                }
+                lua_pushvalue(L, -2);  // p t copy k v k
+                lua_insert(L, -2);  // p t copy k k v
+                lua_rawset(L, -4);  // p t copy k
+            }
+            lua_pushvalue(L, -2);  // p t copy t
+            lua_insert(L, -2);  // p t t copy
+            lua_rawset(L, contents);  // p t
+
+            lua_pushvalue(L, -1);  // p t t
+            if (lua_getmetatable(L, -1))  // p t t mt
+            {
+                if (lua_type(L, -1) == LUA_TTABLE)
+                {
+                    lua_pushvalue(L, -1);  // p t t mt mt
+                    lua_rawseti(L, -5, ++count);  // p t t mt
+                }
+            }
+            else
+            {
+                lua_pushboolean(L, 0);  // p t t false
+            }
+            lua_rawset(L, metatables);  // p t
+            lua_pop(L, 1);
+        }
+
+        // [-0, +0]
+        void RestoreTable(bool registry)  // t copy
+        {
+            // 删除新增的键，遍历时允许清除已有的键
+            lua_pushnil(L);  // t copy nil
+            while (lua_next(L, -3))  // t copy k v
+            {
+                lua_pop(L, 1);  // t copy k
+                if (registry && !IsCheckpointRegistryKey(-1))
+                    continue;
+
+                lua_pushvalue(L, -1);  // t copy k k
+                lua_rawget(L, -3);  // t copy k v0
+                bool added = lua_isnil(L, -1);
+                lua_pop(L, 1);  // t copy k
+                if (added)
+                {
+                    lua_pushvalue(L, -1);  // t copy k k
+                    lua_pushnil(L);  // t copy k k nil
+                    lua_rawset(L, -5);  // t copy k
+                }
+            }
+
+            // 还原被修改或删除的键
+            lua_pushnil(L);  // t copy nil
+            while (lua_next(L, -2))  // t copy k v0
+            {
+                lua_pushvalue(L, -2);  // t copy k v0 k
+                lua_rawget(L, -5);  // t copy k v0 v
+                bool same = (lua_rawequal(L, -1, -2) != 0);
+                lua_pop(L, 1);  // t copy k v0
+                if (same)
+                {
+                    lua_pop(L, 1);  // t copy k
+                }
+                else
+                {
+                    lua_pushvalue(L, -2);  // t copy k v0 k
+                    lua_insert(L, -2);  // t copy k k v0
+                    lua_rawset(L, -5);  // t copy k
+                }
+            }
+        }
+
+    private:
+        GcStatistics m_stGcStatistics;
     };
 }
 }
@@ -0,0 +1,166 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include "Details.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    namespace details
+    {
+        // --- TrustedReader ---
+
+        /**
+         * @brief 不做类型检查的参数读取
+         *
+         * 默认实现仍然使用Stack::Read。
+         */
+        template <typename T, typename = void>
+        struct TrustedReader
+        {
+            static typename ReadResult<T>::Type Read(Stack& st, int idx)
+            {
+                return st.Read<T>(idx);
+            }
+        };
+
+        template <typename T>
+        struct TrustedReader<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, bool>::value>::type>
+        {
+            static bool Read(Stack& st, int idx)
+            {
+                return lua_toboolean(st, idx) != 0;
+            }
+        };
+
+        template <typename T>
+        struct TrustedReader<T, typename std::enable_if<std::is_integral<typename std::decay<T>::type>::value &&
+            !std::is_same<typename std::decay<T>::type, bool>::value>::type>
+        {
+            using ValueType = typename std::decay<T>::type;
+
+            // Lua 5.3起lua_tointeger对非整数值返回0
+            static ValueType Read(Stack& st, int idx)
+            {
+                if (sizeof(lua_Integer) >= sizeof(ValueType))
+                    return static_cast<ValueType>(lua_tointeger(st, idx));
+                return static_cast<ValueType>(lua_tonumber(st, idx));
+            }
+        };
+
+        template <typename T>
+        struct TrustedReader<T, typename std::enable_if<std::is_floating_point<typename std::decay<T>::type>::value>::type>
+        {
+            static typename std::decay<T>::type Read(Stack& st, int idx)
+            {
+                return static_cast<typename std::decay<T>::type>(lua_tonumber(st, idx));
+            }
+        };
+
+        template <typename T>
+        struct TrustedReader<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, const char*>::value>::type>
+        {
+            static const char* Read(Stack& st, int idx)
+            {
+                auto p = lua_tostring(st, idx);
+                return p ? p : st.Read<const char*>(idx);
+            }
+        };
+
+        template <typename T>
+        struct TrustedReader<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, StringView>::value>::type>
+        {
+            static StringView Read(Stack& st, int idx)
+            {
+                StringView ret;
+                ret.Buffer = lua_tolstring(st, idx, &ret.Length);
+                return ret.Buffer ? ret : st.Read<StringView>(idx);
+            }
+        };
+
+        template <typename T>
+        struct TrustedReader<T, typename std::enable_if<std::is_same<typename std::decay<T>::type, std::string>::value>::type>
+        {
+            static std::string Read(Stack& st, int idx)
+            {
+                size_t len = 0;
+                auto p = lua_tolstring(st, idx, &len);
+                return p ? std::string(p, len) : st.Read<std::string>(idx);
+            }
+        };
+
+        // --- TrustedFunctor ---
+
+        template <class TSeq, typename TFunc>
+        struct TrustedFunctor;
+
+        template <int... Ints, typename TRet, typename... TArgs>
+        struct TrustedFunctor<StackIndexSeq<Ints...>, TRet(*)(TArgs...)>
+        {
+            TRet(*Func)(TArgs...);
+
+            TRet operator()(Stack& st)
+            {
+                return Func(TrustedReader<TArgs>::Read(st, Ints)...);
+            }
+        };
+
+        template <int... Ints, typename T, typename TRet, typename... TArgs>
+        struct TrustedFunctor<StackIndexSeq<Ints...>, TRet(T::*)(TArgs...)>
+        {
+            TRet(T::*Func)(TArgs...);
+
+            TRet operator()(Stack& st, T& self)
+            {
+                return (self.*Func)(TrustedReader<TArgs>::Read(st, Ints + 1)...);
+            }
+        };
+
+        template <int... Ints, typename T, typename TRet, typename... TArgs>
+        struct TrustedFunctor<StackIndexSeq<Ints...>, TRet(T::*)(TArgs...)const>
+        {
+            TRet(T::*Func)(TArgs...)const;
+
+            TRet operator()(Stack& st, const T& self)
+            {
+                return (self.*Func)(TrustedReader<TArgs>::Read(st, Ints + 1)...);
+            }
+        };
+    }
+
+    /**
+     * @brief 以快速路径读取参数
+     * @param f 自由函数或成员函数
+     * @return 可直接用于RegisterMethod的函数对象
+     *
+     * 数值与布尔参数直接使用lua_to*读取，不做类型检查，调用方需保证传入的类型正确：
+     * 类型不符的数值参数会被读取为0而不是报错。整数参数在Lua 5.3起不会截断小数，例如1.5会被读取为0；
+     * Lua 5.1与LuaJIT下则截断为1。字符串参数无法转换时回退为Stack::Read，报错行为与普通绑定一致。
+     * 其余类型仍然使用Stack::Read。不支持以Stack&作为参数的函数。
+     */
+    template <typename TRet, typename... TArgs>
+    details::TrustedFunctor<typename details::MakeStackIndexSeq<sizeof...(TArgs)>::Type, TRet(*)(TArgs...)>
+    Trusted(TRet(*f)(TArgs...))
+    {
+        return { f };
+    }
+
+    template <typename T, typename TRet, typename... TArgs>
+    details::TrustedFunctor<typename details::MakeStackIndexSeq<sizeof...(TArgs)>::Type, TRet(T::*)(TArgs...)>
+    Trusted(TRet(T::*f)(TArgs...))
+    {
+        return { f };
+    }
+
+    template <typename T, typename TRet, typename... TArgs>
+    details::TrustedFunctor<typename details::MakeStackIndexSeq<sizeof...(TArgs)>::Type, TRet(T::*)(TArgs...)const>
+    Trusted(TRet(T::*f)(TArgs...)const)
+    {
+        return { f };
+    }
+}
+}
@@ -0,0 +1,287 @@
+/**
+ * @file
+ * @date 2026/10/18
+ * @author chu
+ */
+#pragma once
+#include <new>
+
+#include "Details.hpp"
+
+namespace moe
+{
+namespace LuaWrapper
+{
+    namespace details
+    {
+        template <typename U, typename... T>
+        struct VariantIndexOf;
+
+        template <typename U>
+        struct VariantIndexOf<U> :
+            public std::integral_constant<int, -1>
+        {};
+
+        template <typename U, typename T, typename... TRest>
+        struct VariantIndexOf<U, T, TRest...> :
+            public std::integral_constant<int, std::is_same<U, T>::value ? 0 :
+                (VariantIndexOf<U, TRest...>::value < 0 ? -1 : VariantIndexOf<U, TRest...>::value + 1)>
+        {};
+
+        template <typename T>
+        struct VariantOps
+        {
+            static void Copy(void* dest, const void* src)
+            {
+                new(dest) T(*static_cast<const T*>(src));
+            }
+
+            static void Move(void* dest, void* src)
+            {
+                new(dest) T(std::move(*static_cast<T*>(src)));
+            }
+
+            static void Destroy(void* p)noexcept
+            {
+                static_cast<T*>(p)->~T();
+            }
+
+            static int Push(Stack& st, const void* p)
+            {
+                return st.Push(*static_cast<const T*>(p));
+            }
+        };
+    }
+
+    /**
+     * @brief 多选一的值
+     * @tparam T 候选类型
+     *
+     * 作为参数时按候选类型的声明顺序匹配Lua类型，例如Variant<int, const char*>在传入数字时持有int，
+     * 传入字符串时持有const char*。类型匹配仅检查lua_type，不会引发异常。
+     */
+    template <typename... T>
+    class Variant
+    {
+        static_assert(sizeof...(T) > 0, "Variant requires at least one alternative");
+
+        template <typename U>
+        using IndexOf = details::VariantIndexOf<typename std::decay<U>::type, T...>;
+
+    public:
+        /**
+         * @brief 构造空值
+         */
+        Variant()noexcept = default;
+
+        template <typename U, typename = typename std::enable_if<(IndexOf<U>::value >= 0)>::type>
+        Variant(U&& value)
+        {
+            new(&m_stStorage) typename std::decay<U>::type(std::forward<U>(value));
+            m_iIndex = IndexOf<U>::value;
+        }
+
+        Variant(const Variant& rhs)
+        {
+            if (rhs.m_iIndex >= 0)
+            {
+                kCopy[rhs.m_iIndex](&m_stStorage, &rhs.m_stStorage);
+                m_iIndex = rhs.m_iIndex;
+            }
+        }
+
+        Variant(Variant&& rhs)
+        {
+            if (rhs.m_iIndex >= 0)
+            {
+                kMove[rhs.m_iIndex](&m_stStorage, &rhs.m_stStorage);
+                m_iIndex = rhs.m_iIndex;
+            }
+        }
+
+        ~Variant()
+        {
+            Reset();
+        }
+
+        Variant& operator=(const Variant& rhs)
+        {
+            if (this != &rhs)
+            {
+                Reset();
+                if (rhs.m_iIndex >= 0)
+                {
+                    kCopy[rhs.m_iIndex](&m_stStorage, &rhs.m_stStorage);
+                    m_iIndex = rhs.m_iIndex;
+                }
+            }
+            return *this;
+        }
+
+        Variant& operator=(Variant&& rhs)
+        {
+            if (this != &rhs)
+            {
+                Reset();
+                if (rhs.m_iIndex >= 0)
+                {
+                    kMove[rhs.m_iIndex](&m_stStorage, &rhs.m_stStorage);
+                    m_iIndex = rhs.m_iIndex;
+                }
+            }
+            return *this;
+        }
+
+    public:
+        /**
+         * @brief 获取当前持有的类型下标
+         * @return 为空时返回-1
+         */
+        int GetIndex()const noexcept { return m_iIndex; }
+
+        /**
+         * @brief 是否为空
+         */
+        bool IsEmpty()const noexcept { return m_iIndex < 0; }
+
+        /**
+         * @brief 是否持有给定类型
+         */
+        template <typename U>
+        bool Is()const noexcept
+        {
+            static_assert(IndexOf<U>::value >= 0, "Type is not an alternative of this variant");
+            return m_iIndex == IndexOf<U>::value;
+        }
+
+        /**
+         * @brief 获取给定类型的值
+         *
+         * 调用前需要确认Is<U>()成立。
+         */
+        template <typename U>
+        U& Get()noexcept
+        {
+            assert(Is<U>());
+            return *reinterpret_cast<U*>(&m_stStorage);
+        }
+
+        template <typename U>
+        const U& Get()const noexcept
+        {
+            assert(Is<U>());
+            return *reinterpret_cast<const U*>(&m_stStorage);
+        }
+
+        /**
+         * @brief 尝试获取给定类型的值
+         * @return 类型不符时返回nullptr
+         */
+        template <typename U>
+        U* TryGet()noexcept
+        {
+            return Is<U>() ? reinterpret_cast<U*>(&m_stStorage) : nullptr;
+        }
+
+        template <typename U>
+        const U* TryGet()const noexcept
+        {
+            return Is<U>() ? reinterpret_cast<const U*>(&m_stStorage) : nullptr;
+        }
+
+        /**
+         * @brief 清空
+         */
+        void Reset()noexcept
+        {
+            if (m_iIndex >= 0)
+            {
+                kDestroy[m_iIndex](&m_stStorage);
+                m_iIndex = -1;
+            }
+        }
+
+        /**
+         * @brief 将持有的值压栈
+         * @return 推入的值个数，为空时推入nil
+         */
+        int Push(Stack& st)const
+        {
+            if (m_iIndex < 0)
+            {
+                lua_pushnil(st);
+                return 1;
+            }
+            return kPush[m_iIndex](st, &m_stStorage);
+        }
+
+    private:
+        static constexpr void(*kCopy[])(void*, const void*) = { &details::VariantOps<T>::Copy... };
+        static constexpr void(*kMove[])(void*, void*) = { &details::VariantOps<T>::Move... };
+        static constexpr void(*kDestroy[])(void*) = { &details::VariantOps<T>::Destroy... };
+        static constexpr int(*kPush[])(Stack&, const void*) = { &details::VariantOps<T>::Push... };
+
+        typename std::aligned_union<0, T...>::type m_stStorage;
+        int m_iIndex = -1;
+    };
+
+    template <typename... T>
+    constexpr void(*Variant<T...>::kCopy[])(void*, const void*);
+
+    template <typename... T>
+    constexpr void(*Variant<T...>::kMove[])(void*, void*);
+
+    template <typename... T>
+    constexpr void(*Variant<T...>::kDestroy[])(void*);
+
+    template <typename... T>
+    constexpr int(*Variant<T...>::kPush[])(Stack&, const void*);
+
+    namespace details
+    {
+        template <typename TVariant, typename... T>
+        struct VariantReaderImpl;
+
+        template <typename TVariant>
+        struct VariantReaderImpl<TVariant>
+        {
+            static TVariant Read(Stack& st, int idx)
+            {
+                luaL_argerror(st, idx, "value does not match any alternative");
+                return TVariant();
+            }
+        };
+
+        template <typename TVariant, typename T, typename... TRest>
+        struct VariantReaderImpl<TVariant, T, TRest...>
+        {
+            static TVariant Read(Stack& st, int idx)
+            {
+                if (ArgTypeMatcher<T>::Match(st, idx))
+                    return TVariant(st.Read<T>(idx));
+                return VariantReaderImpl<TVariant, TRest...>::Read(st, idx);
+            }
+        };
+
+        template <typename TVariant>
+        struct VariantReader;
+
+        template <typename... T>
+        struct VariantReader<Variant<T...>> :
+            public VariantReaderImpl<Variant<T...>, T...>
+        {};
+    }
+
+    template <typename T>
+    typename std::enable_if<details::IsVariantType<T>::value, int>::type Stack::Push(const T& rhs)
+    {
+        return rhs.Push(*this);
+    }
+
+    template <typename T>
+    typename std::enable_if<details::IsVariantType<T>::value, typename std::decay<T>::type>::type Stack::Read(int idx)
+    {
+        return details::VariantReader<typename std::decay<T>::type>::Read(*this, idx);
+    }
+}
+}